@@ -0,0 +1,59 @@
+// AppMessages.h
+// Plain-data messages exchanged between firmware tasks through the lock-free
+// queues in SpscQueue.h / MpscQueue.h. Everything is trivially copyable.
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "src/config/BuildConfig.h"
+
+// Sensor task -> control task
+struct TempSample {
+  bool ok = false;         // false when the safety probe read failed (control keeps the last value)
+  float tempC = 0.0f;      // raw safety-probe reading (valid when ok)
+  // All probes (index 0 = safety probe); bit i of probeOkMask marks probeC[i] valid.
+  float probeC[BUILD_DS18B20_MAX_PROBES] = {};
+  uint8_t probeOkMask = 0;
+  bool safetyMissing = false;  // the safety role's ROM is not on the bus (no stand-in probe)
+  uint32_t capturedMs = 0; // millis() when the reading completed
+  uint32_t conversionMs = 0; // measured DS18B20 conversion latency
+};
+
+// Network/BLE -> control task (desired relay state from a remote client)
+struct RelayCommand {
+  enum Source : uint8_t { kRtdb, kBle };
+  bool on = false;
+  Source source = kRtdb;
+};
+
+// Control/network -> network/BLE tasks (work for a RemoteBackend)
+struct OutboundEvent {
+  enum Kind : uint8_t {
+    kTempC,        // probe, tempC
+    kRelayState,   // on
+    kLastUpdate,   // date + time (HH:MM:SS)
+    kUsageStart,   // cycleId, date, time (HH:MM), reason, instruction
+    kUsageEnd,     // cycleId, date, time (HH:MM), reason, instruction, durationSec
+    kUsageTotal,   // date, durationSec = seconds to add to the day's total (BLE mirror)
+    kTempWindow,   // date, time (HH:MM window start), epochSec (start), windowC, on (relay at close)
+  };
+  Kind kind = kTempC;
+  bool on = false;
+  uint8_t probe = 0;          // kTempC: probe index (0 = sensor_1)
+  float tempC = 0.0f;
+  uint32_t cycleId = 0;       // millis() at cycle start; names the cycle node
+  uint32_t durationSec = 0;
+  uint32_t epochSec = 0;      // kUsage*: wall clock at the event (0 = not set)
+  uint32_t journalSeq = 0;    // kUsage*: UsageJournal entry awaiting upload (0 = none)
+  bool redelivered = false;   // kUsage*: replayed from the journal; an earlier send may have landed
+  bool totalCounted = false;  // kUsageEnd: the day's totalDurationSec already holds this cycle
+  const char* reason = "";       // static string literal
+  const char* instruction = "";  // static string literal
+  struct Window {
+    float minC, maxC, meanC, lastC;
+    uint16_t count;
+  } windowC = {};
+  char date[11] = {};  // YYYY-MM-DD captured at event time
+  char time[9] = {};   // HH:MM or HH:MM:SS captured at event time
+};
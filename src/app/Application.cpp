@@ -1,9 +1,10 @@
 // Application.cpp
-// See Application.h for high-level responsibilities.
+// See Application.h for high-level responsibilities. This file holds boot,
+// task plumbing and the sensor/BLE tasks; control and network task logic live
+// in ApplicationControl.cpp and ApplicationNetwork.cpp.
 
 #include "Application.h"
 #include <time.h>
-#include "src/domain/ControlPolicy.h"
 
 void Application::begin() {
   if (initialized_) return;
@@ -13,272 +14,344 @@ void Application::begin() {
   // Load compile- or secrets-provided configuration and derive RTDB root.
   loadStaticConfig();
 
-  initializeWifiAndTime();
+  // Stage 1: local control. Relay, sensor and the control/sensor tasks come
+  // up before anything touches the radio.
+  initializeSensorsAndActuators();
 
-  initializeCloud();
+  // Usage records left from before a reset go out first.
+  restoreUsageJournal();
+  markBoot(BootTimeline::kJournal);
 
-  initializeSensorsAndActuators();
+  bindRemoteBackends();
+  initializeJobs();
+  startLocalTasks();
+
+  // Stage 2: BLE, local control that needs no Wi-Fi.
+  initializeBle();
+  startBleTask();
+
+  // Stage 3: Wi-Fi, SNTP and cloud auth are brought up by the network task
+  // itself (bringUpNetwork), so nothing here waits on the network.
+  startNetworkTask();
 
-  Logger::info("Application initialized. Root path: %s", rtdbPaths_.root().c_str());
+  Logger::info("Application initialized in %u ms. Root path: %s", (unsigned)millis(), rtdbPaths_.root().c_str());
   initialized_ = true;
 }
 
 void Application::runLoop() {
   if (!initialized_) return;
+  // Everything happens in the firmware tasks started by begin().
+  vTaskDelay(pdMS_TO_TICKS(BUILD_TASK_MAX_SLEEP_MS));
+}
 
-  // Placeholder for future task processing. Keep it fast and non-blocking.
-  // We'll add cooperative polling here until FreeRTOS tasks are wired.
-  wifi_.ensureConnected();
-  // Maintain active remote backend (cloud) and BLE side-by-side.
-  selectRemoteBackend();
-  if (remote_) remote_->loop();
+void Application::initializeJobs() {
+  struct Thunks {
+    static void temperature(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->sampleTemperature(nowMs); }
+    static void control(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->evaluateControl(nowMs); }
+    static void service(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->serviceConnectivity(nowMs); }
+    static void settings(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->syncSettings(nowMs); }
+    static void heartbeat(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->publishHeartbeat(nowMs); }
+    static void publish(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->flushPublishQueue(nowMs); }
+    static void history(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->uploadTempWindows(nowMs); }
 #if BUILD_ENABLE_BLE
-  ble_.loop();
+    static void ble(void* ctx, uint32_t nowMs) { static_cast<Application*>(ctx)->serviceBle(nowMs); }
 #endif
-
-  // Periodic control + temperature logging every 10s.
-  static uint32_t lastTempLogMs = 0;
-  static uint32_t lastLastUpdateMs = 0;
+  };
   const uint32_t nowMs = millis();
-  if (nowMs - lastTempLogMs >= 15000u) {
-    lastTempLogMs = nowMs;
-    // Pull/ensure settings once per 10s cycle (simple periodic GETs)
-    float mt = settings_.maxTempC;
-    if (!remote_ || !remote_->ensureMaxTemp(settings_.maxTempC, mt)) {
-      Logger::warn("Settings: ensure max_temp failed");
-    } else {
-      settings_.maxTempC = mt;
-    }
-    float hy = settings_.hysteresisC;
-    if (!remote_ || !remote_->ensureHysteresis(settings_.hysteresisC, hy)) {
-      Logger::warn("Settings: ensure hysteresis failed");
-    } else {
-      settings_.hysteresisC = hy;
-    }
-    String custom;
-    if (!remote_ || !remote_->ensureCustomTime(settings_.customTime.length() ? settings_.customTime : String("05:00"), custom)) {
-      Logger::warn("Settings: ensure CUSTOM failed");
-    } else {
-      settings_.customTime = custom;
-    }
-    if (remote_) {
-      remote_->ensureTimerFlag("04:00", false, settings_.t0400);
-      remote_->ensureTimerFlag("06:00", false, settings_.t0600);
-      remote_->ensureTimerFlag("08:00", false, settings_.t0800);
-      remote_->ensureTimerFlag("16:00", false, settings_.t1600);
-      remote_->ensureTimerFlag("18:00", false, settings_.t1800);
-    }
-#if BUILD_LOG_SETTINGS_VERBOSE
-    Logger::warn(
-      "Timers: { 04:00: %s, 06:00: %s, 08:00: %s, 16:00: %s, 18:00: %s, CUSTOM: %s }",
-      settings_.t0400 ? "true" : "false",
-      settings_.t0600 ? "true" : "false",
-      settings_.t0800 ? "true" : "false",
-      settings_.t1600 ? "true" : "false",
-      settings_.t1800 ? "true" : "false",
-      settings_.customTime.c_str()
-    );
-    Logger::warn("Max-T: Target Temperature = %.0f'C (hyst=%.1fC)", settings_.maxTempC, settings_.hysteresisC);
-#endif
-    // DS18B20 smoothing + failure backoff
-    // Strategy:
-    // 1) Only attempt a sensor read if we are past `nextTempReadAllowedMs_` (backoff gate).
-    // 2) On read failure, increment `tempFailCount_` and exponentially increase the backoff
-    //    before the next read attempt (capped at 60 seconds). This avoids hammering the bus
-    //    when the sensor is absent or wiring is faulty.
-    // 3) On read success, reset the failure counter and update an Exponential Moving Average (EMA)
-    //    into `smoothedTempC_` using alpha=0.3 (first sample seeds the EMA). We publish the raw
-    //    reading to RTDB for transparency but use the smoothed value for control decisions to
-    //    reduce jitter.
-    // 4) If in a backoff window and we already have a smoothed value, we reuse it; otherwise,
-    //    we log that no temperature is currently available.
-    float tC = 0.0f;
-    bool haveTemp = false;
-    if (nowMs >= nextTempReadAllowedMs_) {
-      // Attempt a fresh read from the sensor since backoff gate is open
-      haveTemp = temp_.readCelsius(tC);
-      if (!haveTemp) {
-        // Failure: increase the failure count and compute next backoff
-        // Base backoff is 1s and doubles each failure (1,2,4,8,16,32,64),
-        // capped to 60,000 ms. The `min(tempFailCount_, 6)` caps the power-of-two
-        // at 2^6 = 64s, and the outer min() clamps it to 60s hard.
-        tempFailCount_++;
-        uint32_t backoff = min<uint32_t>(60000u, (uint32_t)(1000u * (1u << min(tempFailCount_, 6))));
-        nextTempReadAllowedMs_ = nowMs + backoff;
-        Logger::warn("Temp: device not found or read failed (fail=%d, backoff=%ums)", tempFailCount_, backoff);
-      } else {
-        // Success: reset failure/backoff state
-        tempFailCount_ = 0;
-        nextTempReadAllowedMs_ = nowMs;
-        // Update EMA smoothing: first sample seeds the average; subsequent samples blend
-        // using alpha=0.3 (70% of the previous average retained).
-        if (!haveSmoothedTemp_) {
-          smoothedTempC_ = tC;       // seed EMA on first successful read
-          haveSmoothedTemp_ = true;
-        } else {
-          const float alpha = 0.3f;  // smoothing factor; lower = smoother, slower to react
-          smoothedTempC_ = alpha * tC + (1.0f - alpha) * smoothedTempC_;
-        }
-        // Publish raw reading for observability; control below uses `smoothedTempC_`.
-        Logger::info("Temp: %.2f C (smoothed=%.2f)", tC, smoothedTempC_);
-        if (remote_) remote_->publishTempC(tC);
+  // Priority: higher runs first when several jobs of the same task are due.
+  // First-run offsets stagger the 15 s jobs so they never share a pass.
+  tempJob_ = sensorSched_.addJob("temperature", &Thunks::temperature, this, nowMs, BUILD_TEMP_PERIOD_MS, 0, 1, 0);
+  controlSched_.addJob("control", &Thunks::control, this, nowMs, BUILD_CONTROL_PERIOD_MS, 0, 1, 1000);
+  networkSched_.addJob("service", &Thunks::service, this, nowMs, BUILD_SERVICE_PERIOD_MS, 0, 2, 0);
+  networkSched_.addJob("settings", &Thunks::settings, this, nowMs, BUILD_SETTINGS_PERIOD_MS, 1000, 1, 3000);
+  networkSched_.addJob("heartbeat", &Thunks::heartbeat, this, nowMs, BUILD_HEARTBEAT_PERIOD_MS, 1000, 0, 9000);
+  networkSched_.addJob("publish", &Thunks::publish, this, nowMs, BUILD_PUBLISH_PERIOD_MS, 0, 1, 0);
+  networkSched_.addJob("history", &Thunks::history, this, nowMs, BUILD_TEMP_UPLOAD_PERIOD_MS, 5000, 0,
+                       BUILD_TEMP_UPLOAD_PERIOD_MS);
+  publishQ_.setMinInterval(PublishQueue::kTelemetry, BUILD_PUBLISH_TEMP_MIN_MS);
+  publishQ_.setMinInterval(PublishQueue::kHeartbeat, BUILD_PUBLISH_HEARTBEAT_MIN_MS);
 #if BUILD_ENABLE_BLE
-        // Mirror temperature over BLE when BLE is enabled.
-        if (remote_ != static_cast<RemoteBackend*>(&ble_)) {
-          ble_.publishTempC(tC);
-        }
+  bleSched_.addJob("ble", &Thunks::ble, this, nowMs, BUILD_BLE_SERVICE_PERIOD_MS, 0, 1, 0);
 #endif
-      }
-    } else {
-      // We are currently in a backoff window; skip hitting the sensor bus.
-      // If we have a previously smoothed value, reuse it for control decisions;
-      // otherwise we log lack of data and control will treat temp as unavailable.
-      haveTemp = haveSmoothedTemp_;
-      if (!haveTemp) Logger::warn("Temp: backoff active and no prior value");
-    }
+}
 
-    // Fire schedule triggers at exact times (start-only), then safety will auto-OFF at maxTemp
-    processScheduleTriggers(haveTemp, tC);
-    bool scheduleActive = false; // triggers now manage ON; leave false here
-
-    // Control evaluation (command handled via stream for ON decisions)
-    ControlInputs ci{};
-    ci.hasCommand = false;        // command stream sets relay directly; no latched command cache yet
-    ci.commandOn = false;
-    ci.scheduleActive = scheduleActive;
-    // For control, prefer the smoothed temperature (if available) to avoid
-    // rapid toggling near thresholds. If not available, use 0.0 which is
-    // interpreted alongside `haveTemp` checks below.
-    ci.tempC = haveTemp ? smoothedTempC_ : 0.0f;
-    ci.maxTempC = settings_.maxTempC;
-    ci.hysteresisC = settings_.hysteresisC;
-    ci.relayCurrentlyOn = relay_.isOn();
-
-    ControlDecision cd = ControlPolicy::evaluate(ci);
-    // Only apply control if it would turn OFF due to safety; ON decisions are left to command/schedule
-    // Enforce safety cutoff only when we actually have a valid temperature reading.
-    if (haveTemp && ci.tempC >= ci.maxTempC && relay_.isOn()) {
-      relay_.setOn(false);
-      Logger::warn("Control: target temperature cutoff at %.2f >= %.2f -> OFF", ci.tempC, ci.maxTempC);
-      if (remote_) remote_->publishRelayState(false);
+void Application::startLocalTasks() {
+  sensorCtx_ = TaskContext{this, &sensorSched_, &Application::applySensorConfig};
+  controlCtx_ = TaskContext{this, &controlSched_, &Application::drainControlInbox, &Application::controlStarted};
+  // Control first so producers always have a valid handle to notify.
+  if (xTaskCreate(&Application::taskEntry, "control", BUILD_TASK_CONTROL_STACK, &controlCtx_,
+                  BUILD_TASK_CONTROL_PRIO, &controlTask_) != pdPASS) {
+    Logger::error("Tasks: failed to start control task");
+  }
+  if (xTaskCreate(&Application::taskEntry, "sensor", BUILD_TASK_SENSOR_STACK, &sensorCtx_,
+                  BUILD_TASK_SENSOR_PRIO, &sensorTask_) != pdPASS) {
+    Logger::error("Tasks: failed to start sensor task");
+  }
+}
+
+void Application::startBleTask() {
 #if BUILD_ENABLE_BLE
-      if (remote_ != static_cast<RemoteBackend*>(&ble_)) {
-        ble_.publishRelayState(false);
-      }
+  bleCtx_ = TaskContext{this, &bleSched_, &Application::drainBleOutbox};
+  if (xTaskCreate(&Application::taskEntry, "ble", BUILD_TASK_BLE_STACK, &bleCtx_,
+                  BUILD_TASK_BLE_PRIO, &bleTask_) != pdPASS) {
+    Logger::error("Tasks: failed to start BLE task");
+  }
 #endif
-      recordUsageOff("targetTemp", "fromDevice");
-    }
+}
 
-    // Concise control decision log
-    const char* cmdStr = lastCommandKnown_ ? (lastCommandOn_ ? "ON" : "OFF") : "n/a";
-    Logger::info(
-      "Decision: cmd=%s, sched=%s, temp=%.1fC, hyst=%.1fC, state=%s",
-      cmdStr,
-      (scheduleActive ? "ON" : "OFF"),
-      ci.tempC,
-      settings_.hysteresisC,
-      relay_.isOn() ? "ON" : "OFF"
-    );
+void Application::startNetworkTask() {
+  networkCtx_ = TaskContext{this, &networkSched_, &Application::drainNetworkOutbox, &Application::bringUpNetwork};
+  if (xTaskCreate(&Application::taskEntry, "network", BUILD_TASK_NETWORK_STACK, &networkCtx_,
+                  BUILD_TASK_NETWORK_PRIO, &networkTask_) != pdPASS) {
+    Logger::error("Tasks: failed to start network task");
   }
+}
 
-  // Periodic LastUpdate write (time/date) every 10s, rate-limited
-  if (nowMs - lastLastUpdateMs >= 15000u) {
-    lastLastUpdateMs = nowMs;
-    time_t nowSec = clock_.now();
-    if (nowSec > 0) {
-      struct tm *lt = localtime(&nowSec);
-      if (lt) {
-        char timeBuf[9];   // HH:MM:SS
-        char dateBuf[11];  // YYYY-MM-DD
-        strftime(timeBuf, sizeof(timeBuf), "%H:%M:%S", lt);
-        strftime(dateBuf, sizeof(dateBuf), "%Y-%m-%d", lt);
-        if (remote_) remote_->publishLastUpdate(String(timeBuf), String(dateBuf));
+void Application::taskEntry(void* arg) {
+  const TaskContext* ctx = static_cast<const TaskContext*>(arg);
+  ctx->app->runTask(*ctx);
+}
+
+void Application::runTask(const TaskContext &ctx) {
+  if (ctx.start) (this->*ctx.start)();
+  for (;;) {
+    if (ctx.drain) (this->*ctx.drain)();
+    ctx.sched->runDue(millis());
+    // Block until the next deadline; a producer's xTaskNotifyGive() wakes us
+    // early (a notification given after the drain above is not lost).
+    const uint32_t waitMs = ctx.sched->msUntilNextDue(millis(), BUILD_TASK_MAX_SLEEP_MS);
+    if (waitMs > 0) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+  }
+}
+
+bool Application::mirrorToBle() const {
 #if BUILD_ENABLE_BLE
-        if (remote_ != static_cast<RemoteBackend*>(&ble_)) {
-          ble_.publishLastUpdate(String(timeBuf), String(dateBuf));
-        }
+  return remote_ != static_cast<const RemoteBackend*>(&ble_);
+#else
+  return false;
 #endif
-      }
+}
+
+bool Application::remoteIsBle() const {
+#if BUILD_ENABLE_BLE
+  return remote_ == static_cast<const RemoteBackend*>(&ble_);
+#else
+  return false;
+#endif
+}
+
+// ---- Sensor task -------------------------------------------------------------
+
+void Application::sampleTemperature(uint32_t nowMs) {
+  // Non-blocking DS18B20 cycle driven by this one job:
+  //   idle -> startConversion() -> poll every BUILD_TEMP_POLL_MS -> collect -> idle
+  // The job reschedules itself with runAfter() between steps, so the task
+  // sleeps (and other tasks run) for the whole conversion time.
+  // Full cycles convert every probe with one broadcast; fast safety cycles
+  // (relay ON, no telemetry due) convert only the 9-bit safety probe.
+  if (temp_.conversionPending()) {
+    if (!temp_.pollReady(nowMs)) {
+      sensorSched_.runAfter(tempJob_, nowMs, BUILD_TEMP_POLL_MS);
+      return;
+    }
+#if BUILD_DS18B20_ALARM_SCREEN
+    // Fast safety cycle: if no probe crossed TH, the alarm search already
+    // answered the only question we had. An empty search is only believed
+    // while the safety probe has recently been read for real.
+    const bool safetyFresh = lastSafetyReadMs_ != 0 && (nowMs - lastSafetyReadMs_) < BUILD_DS18B20_ALARM_TRUST_MS;
+    if (!fullCycle_ && safetyFresh && temp_.alarmsProgrammed() && !temp_.alarmFlagged()) {
+      temp_.discardConversion();
+      alarmScreenedSkips_++;
+      Logger::debug("Temp: alarm search clear, readout skipped (skips=%u)", (unsigned)alarmScreenedSkips_);
+    } else
+#endif
+    {
+      DS18B20Sensor::Readings readings;
+      const bool ok = temp_.collect(readings);
+      if (ok && fullCycle_) lastFullSampleMs_ = nowMs;
+      finishTempSample(nowMs, readings, ok);
     }
+    // Resume the regular cadence measured from the start of this cycle.
+    const uint32_t spent = nowMs - tempCycleStartMs_;
+    const uint32_t period = sensorSched_.periodOf(tempJob_);
+    sensorSched_.runAfter(tempJob_, nowMs, spent < period ? period - spent : 0);
+    return;
   }
-
-  delay(5);  // Yield briefly to avoid tight spin in early skeleton
+  // Backoff gate: skip the bus entirely until `nextTempReadAllowedMs_`.
+  if ((int32_t)(nowMs - nextTempReadAllowedMs_) < 0) return;
+  rescanProbes(nowMs);
+  tempCycleStartMs_ = nowMs;
+  const bool telemetryDue = lastFullSampleMs_ == 0 || (nowMs - lastFullSampleMs_) >= BUILD_TEMP_PERIOD_MS;
+  fullCycle_ = telemetryDue || !relayOnShared_.load(std::memory_order_relaxed);
+  const bool started = fullCycle_ ? temp_.startConversion()
+                                  : temp_.startConversion(DS18B20Sensor::kSafetyProbe);
+  if (!started) {
+    finishTempSample(nowMs, DS18B20Sensor::Readings{}, false);
+    return;
+  }
+  sensorSched_.runAfter(tempJob_, nowMs, BUILD_TEMP_POLL_MS);
 }
 
-String Application::currentTimeStr() const {
-  time_t nowSec = time(nullptr);
-  struct tm *lt = localtime(&nowSec);
-  if (!lt) return String("00:00");
-  char buf[9];
-  strftime(buf, sizeof(buf), "%H:%M", lt);
-  return String(buf);
+void Application::applySensorConfig() {
+  // Runs on every wake of the sensor task; control notifies us when the relay
+  // or the thresholds change. Nothing is touched mid-conversion; the new
+  // period is picked up when the sample completes.
+  if (temp_.conversionPending()) return;
+  const int high = alarmHighShared_.load(std::memory_order_relaxed);
+  temp_.setAlarmThresholds((int8_t)constrain(high, -55, 125), (int8_t)-55);
+  // Cadence chosen by control's SamplingPolicy.
+  const uint32_t desired = samplePeriodShared_.load(std::memory_order_relaxed);
+  if (sensorSched_.periodOf(tempJob_) == desired) return;
+  sensorSched_.setPeriod(tempJob_, desired, millis());
 }
 
-String Application::currentDateStr() const {
-  time_t nowSec = time(nullptr);
-  struct tm *lt = localtime(&nowSec);
-  if (!lt) return String("1970-01-01");
-  char buf[11];
-  strftime(buf, sizeof(buf), "%Y-%m-%d", lt);
-  return String(buf);
-}
-
-String Application::usageDayPath() const {
-  return rtdbPaths_.usageDay(currentDateStr());
-}
-
-void Application::recordUsageOn(const char* reason, const char* instruction) {
-  String pushId = String("cy_") + String(millis());
-  openCycleId_ = pushId;
-  openCycleStartMs_ = millis();
-  String base = usageDayPath() + "/cycles/" + pushId + "/";
-  if (remote_) {
-    remote_->setStringPath(base + "startTime", currentTimeStr());
-    remote_->setStringPath(base + "startReason", String(reason));
-    remote_->setStringPath(base + "startInstruction", String(instruction));
+void Application::rescanProbes(uint32_t nowMs) {
+  // begin() enumerates once; a probe that was late, loose or plugged in later
+  // is only found by searching the bus again. Runs between conversions only.
+  // A bound probe that is missing (or failing) is searched for with a backoff
+  // from RESCAN_MIN to RESCAN_MAX. With every bound probe answering, free
+  // roles are only looked for with a backoff that doubles after each search
+  // that finds nothing new (RESCAN_MAX up to DISCOVER_MAX).
+  const uint8_t allRoles = (uint8_t)((1u << DS18B20Sensor::kMaxProbes) - 1);
+  const bool missing = !temp_.hasDevice() || tempFailCount_ > 0 || probesMissing_ ||
+                       (temp_.boundMask() & ~temp_.presentMask());
+  if (!missing && temp_.boundMask() == allRoles) return;
+  if ((int32_t)(nowMs - nextProbeScanMs_) < 0) return;
+  const bool changed = temp_.rescan();
+  if (missing) {
+    nextProbeScanMs_ = nowMs + probeScanBackoffMs_;
+    probeScanBackoffMs_ = min<uint32_t>(BUILD_DS18B20_RESCAN_MAX_MS, probeScanBackoffMs_ * 2);
+  } else {
+    probeDiscoverBackoffMs_ = changed ? BUILD_DS18B20_RESCAN_MAX_MS
+                                      : min<uint32_t>(BUILD_DS18B20_DISCOVER_MAX_MS, probeDiscoverBackoffMs_ * 2);
+    nextProbeScanMs_ = nowMs + probeDiscoverBackoffMs_;
   }
+  // A changed probe set needs its TH/TL programmed before alarm screening.
+  if (!temp_.alarmsProgrammed()) applySensorConfig();
 }
 
-void Application::recordUsageOff(const char* reason, const char* instruction) {
-  if (openCycleId_.length() == 0) return;
-  uint32_t dur = 0;
-  if (openCycleStartMs_ != 0) dur = (millis() - openCycleStartMs_) / 1000u;
-  String base = usageDayPath() + "/cycles/" + openCycleId_ + "/";
-  if (remote_) {
-    remote_->setStringPath(base + "endTime", currentTimeStr());
-    remote_->setStringPath(base + "endReason", String(reason));
-    remote_->setStringPath(base + "endInstruction", String(instruction));
-    remote_->setIntPath(base + "durationSec", (int)dur);
+void Application::finishTempSample(uint32_t nowMs, const DS18B20Sensor::Readings &readings, bool ok) {
+  // DS18B20 failure backoff
+  // Strategy:
+  // 1) Only start a conversion if we are past `nextTempReadAllowedMs_` (backoff gate).
+  // 2) On read failure, increment `tempFailCount_` and exponentially increase the backoff
+  //    before the next read attempt (capped at 60 seconds). This avoids hammering the bus
+  //    when the sensor is absent or wiring is faulty.
+  // 3) Every attempt is handed to the control task, which smooths successful readings
+  //    and keeps the previous value on failure.
+  TempSample sample;
+  sample.ok = ok;
+  sample.tempC = readings.tempC[DS18B20Sensor::kSafetyProbe];
+  sample.safetyMissing = temp_.safetyProbeMissing();
+  for (uint8_t p = 0; p < DS18B20Sensor::kMaxProbes; p++) {
+    if (!readings.ok[p]) continue;
+    sample.probeC[p] = readings.tempC[p];
+    sample.probeOkMask |= (uint8_t)(1u << p);
+  }
+  if (readings.ok[DS18B20Sensor::kSafetyProbe]) lastSafetyReadMs_ = nowMs;
+  sample.capturedMs = nowMs;
+  sample.conversionMs = temp_.lastConversionLatencyMs();
+  if (fullCycle_) {
+    // Any present probe that did not answer a full cycle triggers a rescan.
+    probesMissing_ = false;
+    for (uint8_t p = 0; p < DS18B20Sensor::kMaxProbes; p++) {
+      if (temp_.present(p) && !readings.ok[p]) probesMissing_ = true;
+    }
+    if (ok && !probesMissing_) probeScanBackoffMs_ = BUILD_DS18B20_RESCAN_MIN_MS;
+  }
+  if (!ok) {
+    // Failure: increase the failure count and compute next backoff
+    // Base backoff is 1s and doubles each failure (1,2,4,8,16,32,64),
+    // capped to 60,000 ms. The `min(tempFailCount_, 6)` caps the power-of-two
+    // at 2^6 = 64s, and the outer min() clamps it to 60s hard.
+    tempFailCount_++;
+    uint32_t backoff = min<uint32_t>(60000u, (uint32_t)(1000u * (1u << min(tempFailCount_, 6))));
+    nextTempReadAllowedMs_ = nowMs + backoff;
+    Logger::warn("Temp: device not found or read failed (fail=%d, backoff=%ums)", tempFailCount_, backoff);
+  } else {
+    // Success: reset failure/backoff state
+    tempFailCount_ = 0;
+    nextTempReadAllowedMs_ = nowMs;
   }
-  addUsageToDailyTotal(dur);
-  openCycleId_.remove(0);
-  openCycleStartMs_ = 0;
+  if (!sensorQ_.push(sample)) Logger::warn("Tasks: sensor queue full (dropped=%u)", (unsigned)sensorQ_.dropped());
+  notify(controlTask_);
 }
 
-void Application::addUsageToDailyTotal(uint32_t durationSec) {
-  // read-modify-write totalDurationSec for the day
-  String dayPath = usageDayPath();
-  int total = 0;
-  if (!remote_ || !remote_->getIntPath(dayPath + "/totalDurationSec", total)) {
-    total = 0;  // assume missing
-  }
-  total += (int)durationSec;
-  if (remote_) remote_->setIntPath(dayPath + "/totalDurationSec", total);
+// ---- BLE task ----------------------------------------------------------------
+
+void Application::serviceBle(uint32_t /*nowMs*/) {
+#if BUILD_ENABLE_BLE
+  ble_.loop();
+  uint32_t fromSec = 0, toSec = 0;
+  if (ble_.takeHistoryRequest(fromSec, toSec)) bleHistory_ = history_.query(fromSec, toSec);
+  if (!bleHistory_.done()) ble_.streamHistory(bleHistory_, BUILD_BLE_HISTORY_POINTS_PER_PASS);
+#endif
+}
+
+void Application::drainBleOutbox() {
+#if BUILD_ENABLE_BLE
+  OutboundEvent ev;
+  while (bleOutQ_.pop(ev)) executeBleOutbound(ev);
+#endif
+}
+
+void Application::executeBleOutbound(const OutboundEvent &ev) {
 #if BUILD_ENABLE_BLE
-  // Mirror usage total over BLE so the characteristic stays in sync.
-  ble_.setIntPath(dayPath + "/totalDurationSec", total);
+  switch (ev.kind) {
+    case OutboundEvent::kTempC:
+      ble_.publishProbeTempC(ev.probe, ev.tempC);
+      break;
+    case OutboundEvent::kRelayState:
+      ble_.publishRelayState(ev.on);
+      break;
+    case OutboundEvent::kLastUpdate:
+      ble_.publishLastUpdate(String(ev.time), String(ev.date));
+      break;
+    case OutboundEvent::kUsageTotal:
+      // Mirror usage total over BLE so the characteristic stays in sync.
+      ble_.incrementIntPath(usageDayPath(ev.date) + "/totalDurationSec", (int)ev.durationSec);
+      break;
+    default:
+      break;  // usage cycle details are cloud-only
+  }
+#else
+  (void)ev;
 #endif
 }
 
+// ---- Boot helpers ------------------------------------------------------------
+
+void Application::formatLocalTime(char* buf, size_t len, const char* fmt, const char* fallback) {
+  time_t nowSec = time(nullptr);
+  struct tm lt;
+  if (!localtime_r(&nowSec, &lt)) {
+    strncpy(buf, fallback, len - 1);
+    buf[len - 1] = '\0';
+    return;
+  }
+  strftime(buf, len, fmt, &lt);
+}
+
+String Application::usageDayPath(const char* isoDate) const {
+  return rtdbPaths_.usageDay(String(isoDate));
+}
+
+String Application::usageCyclePath(const char* isoDate, uint32_t cycleId) const {
+  return usageDayPath(isoDate) + "/cycles/cy_" + String((unsigned long)cycleId) + "/";
+}
+
 void Application::initializeLogger() {
   // Initialize Serial with a reasonable baud rate for logs.
   Serial.begin(BUILD_LOG_BAUD_RATE);
-  while (!Serial) {
-    // Wait briefly for Serial on boards that require it; timeout to avoid boot stalls.
+  // Wait briefly for Serial on boards that require it (USB CDC); bounded so
+  // a missing host never delays relay control.
+  const uint32_t waitStartMs = millis();
+  while (!Serial && millis() - waitStartMs < BUILD_LOG_SERIAL_WAIT_MS) {
     delay(10);
   }
   Logger::setLevel(LOG_LEVEL_INFO);
   Logger::info("Logger initialized (baud=%d)", BUILD_LOG_BAUD_RATE);
+  markBoot(BootTimeline::kLogger);
 }
 
 void Application::loadStaticConfig() {
@@ -287,32 +360,60 @@ void Application::loadStaticConfig() {
   rtdbPaths_.userId = SECRETS_USER_ID;      // provisioned later
 }
 
-void Application::initializeWifiAndTime() {
-  // Start Wi-Fi connect sequence with exponential backoff.
+void Application::bringUpNetwork() {
+  // First thing the network task does: relay control and BLE are already up.
+  // Start Wi-Fi connect sequence with exponential backoff; serviceConnectivity
+  // drives it from here, no waiting.
   wifi_.begin(SECRETS_WIFI_SSID, SECRETS_WIFI_PASSWORD);
+  markBoot(BootTimeline::kWifiStart);
 
-  // Non-blocking: opportunistically wait a short time to get initial connection.
-  const uint32_t softWaitMs = 3000;  // short bootstrap window
-  uint32_t start = millis();
-  while (millis() - start < softWaitMs) {
-    if (wifi_.ensureConnected()) break;
-    delay(50);
-  }
-  if (wifi_.isConnected()) {
+  // Initialize SNTP time (South Africa Standard Time example: SAST-2)
+  clock_.begin("SAST-2");
+
+  initializeCloud();
+  markBoot(BootTimeline::kCloudInit);
+}
+
+void Application::controlStarted() {
+  // Commands and the safety cutoff are served from here on.
+  markBoot(BootTimeline::kControl);
+}
+
+bool Application::markBoot(BootTimeline::Stage stage) {
+  const uint32_t nowMs = millis();
+  if (!boot_.mark(stage, nowMs)) return false;
+  Logger::info("Boot: %s at %u ms", BootTimeline::name(stage), (unsigned)nowMs);
+  return true;
+}
+
+void Application::trackNetworkBoot() {
+  // Network task, until the cloud is up: stages nobody else reports.
+  if (wifi_.isConnected() && markBoot(BootTimeline::kWifiUp)) {
     Logger::info("WiFi up: IP=%s RSSI=%d", wifi_.localIp().toString().c_str(), wifi_.getRssi());
-  } else {
-    Logger::warn("WiFi not connected yet; continuing with background retries");
   }
+  if (clock_.isSynced()) markBoot(BootTimeline::kTimeSync);
+  if (boot_.reached(BootTimeline::kWifiUp) && remote_ && remote_->isHealthy() &&
+      markBoot(BootTimeline::kCloudUp)) {
+    logBootTimeline();
+  }
+}
 
-  // Initialize SNTP time (South Africa Standard Time example: SAST-2)
-  clock_.begin("SAST-2");
+void Application::logBootTimeline() {
+  // One line with every stage reached so far (the per-stage lines may have
+  // been printed before a serial monitor attached).
+  char line[256];
+  int n = snprintf(line, sizeof(line), "Boot timeline (ms):");
+  for (uint8_t i = 0; i < BootTimeline::kStageCount && n > 0 && n < (int)sizeof(line); i++) {
+    const auto stage = (BootTimeline::Stage)i;
+    if (!boot_.reached(stage)) continue;
+    n += snprintf(line + n, sizeof(line) - n, " %s=%u", BootTimeline::name(stage), (unsigned)boot_.atMs(stage));
+  }
+  Logger::info("%s", line);
 }
 
 void Application::initializeSensorsAndActuators() {
-  // Initialize DS18B20 (may not be connected yet; begin() will warn if none).
-  temp_.begin(PIN_DS18B20_DATA);
-
-  // Initialize relay/LED on GPIO defined in Pins.h.
+  // Initialize relay/LED on GPIO defined in Pins.h first: the output is in a
+  // defined (off) state before anything else runs.
   // Typical relay modules are active-LOW; onboard LEDs are usually active-HIGH.
   bool activeLow = false;
   if (PIN_RELAY_CTRL == 15) {
@@ -320,80 +421,46 @@ void Application::initializeSensorsAndActuators() {
   }
   relay_ = GpioRelay(activeLow);
   relay_.begin(PIN_RELAY_CTRL);
-}
-
-int Application::parseHhmmToMinutes(const String &hhmm) {
-  if (hhmm.length() != 5 || hhmm.charAt(2) != ':') return -1;
-  int hh = hhmm.substring(0,2).toInt();
-  int mm = hhmm.substring(3,5).toInt();
-  if (hh < 0 || hh > 23 || mm < 0 || mm > 59) return -1;
-  return hh * 60 + mm;
-}
-
-// legacy window checker removed; triggers manage ON behavior
-
-void Application::processScheduleTriggers(bool haveTemp, float tempC) {
-  // Reset fired mask on new day
-  time_t nowSec = time(nullptr);
-  struct tm *lt = localtime(&nowSec);
-  if (!lt) return;
-  if (lastScheduleYDay_ != lt->tm_yday) {
-    lastScheduleYDay_ = lt->tm_yday;
-    scheduleFiredMask_ = 0;
-  }
 
-  auto maybeFire = [&](int bit, const char* hhmmFlag, bool enabled){
-    if (!enabled) return;
-    int startMin = parseHhmmToMinutes(String(hhmmFlag));
-    if (startMin < 0) return;
-    int nowMin = lt->tm_hour * 60 + lt->tm_min;
-    // Allow a 0..59s window since our loop ticks every ~10s; match on minute only
-    if (nowMin == startMin) {
-      if ((scheduleFiredMask_ & (1u << bit)) == 0) {
-        // Fire ON if below re-enable threshold
-        float reenable = settings_.maxTempC - settings_.hysteresisC; // hysteresis
-        if (!haveTemp || tempC < reenable) {
-          relay_.setOn(true);
-          if (haveTemp) {
-            Logger::info("Schedule: trigger %s -> ON (temp=%.1f < %.1f)", hhmmFlag, tempC, reenable);
-          } else {
-            Logger::info("Schedule: trigger %s -> ON (no temp yet)", hhmmFlag);
-          }
-          if (remote_) remote_->publishRelayState(true);
-#if BUILD_ENABLE_BLE
-          if (remote_ != static_cast<RemoteBackend*>(&ble_)) {
-            ble_.publishRelayState(true);
-          }
-#endif
-          recordUsageOn("schedule", "fromDevice");
-        } else {
-          Logger::info("Schedule: trigger %s skipped (temp=%.1f >= %.1f)", hhmmFlag, tempC, reenable);
-        }
-        scheduleFiredMask_ |= (1u << bit);
-      }
-    }
-  };
+  SamplingPolicy::Bounds bounds;
+  bounds.nearCutoffMs = BUILD_SAFETY_PERIOD_MS;
+  bounds.heatingMs = BUILD_SAMPLE_HEATING_PERIOD_MS;
+  bounds.idleMs = BUILD_TEMP_PERIOD_MS;
+  bounds.idleStableMs = BUILD_SAMPLE_IDLE_PERIOD_MS;
+  bounds.nearBandC = BUILD_SAMPLE_NEAR_CUTOFF_C;
+  bounds.stableDeltaC = BUILD_SAMPLE_STABLE_DELTA_C;
+  bounds.stableCount = BUILD_SAMPLE_STABLE_COUNT;
+  sampling_.setBounds(bounds);
+  TemperatureFilter::Config filter;
+  filter.medianWindow = BUILD_TEMP_MEDIAN_WINDOW;
+  filter.smoother = (TemperatureFilter::Smoother)BUILD_TEMP_SMOOTHER;
+  filter.emaAlpha = BUILD_TEMP_EMA_ALPHA;
+  filter.kalmanQ = BUILD_TEMP_KALMAN_Q;
+  filter.kalmanR = BUILD_TEMP_KALMAN_R;
+  filter.slopeWindow = BUILD_TEMP_SLOPE_WINDOW;
+  filter.maxHorizonMs = BUILD_TEMP_PERIOD_MS;
+  tempFilter_.configure(filter);
+  TelemetryGate::Config gate;
+  gate.deadbandC = BUILD_TELEMETRY_DEADBAND_C;
+  gate.heartbeatMs = BUILD_TELEMETRY_HEARTBEAT_MS;
+  for (auto &g : tempGates_) g.configure(gate);
+  tempWindow_.setWindowSec(BUILD_TEMP_WINDOW_SEC);
+
+  // After a soft reset the relay goes straight back to where it was (the
+  // configuration above is RAM-only and takes microseconds).
+  restoreWarmState();
+  markBoot(BootTimeline::kRelay);
 
-  maybeFire(0, "04:00", settings_.t0400);
-  maybeFire(1, "06:00", settings_.t0600);
-  maybeFire(2, "08:00", settings_.t0800);
-  maybeFire(3, "16:00", settings_.t1600);
-  maybeFire(4, "18:00", settings_.t1800);
-  if (settings_.customTime.length() == 5) {
-    maybeFire(5, settings_.customTime.c_str(), true);
-  }
+  // Initialize DS18B20 (may not be connected yet; begin() will warn if none).
+  temp_.begin(PIN_DS18B20_DATA);
+  const bool probeMissing = !temp_.hasDevice() || (temp_.boundMask() & ~temp_.presentMask());
+  nextProbeScanMs_ = millis() + (probeMissing ? BUILD_DS18B20_RESCAN_MIN_MS : BUILD_DS18B20_RESCAN_MAX_MS);
+  markBoot(BootTimeline::kSensor);
 }
 
-void Application::initializeCloud() {
-  // Initialize RTDB client and BLE backend. When a command comes in from either,
-  // toggle relay immediately.
-#if BUILD_ENABLE_RTDB
-  rtdb_.begin(&rtdbPaths_);
-#endif
-#if BUILD_ENABLE_BLE
-  ble_.begin(&rtdbPaths_);
-#endif
-  // Primary backend is RTDB when enabled; BLE runs side-by-side.
+void Application::bindRemoteBackends() {
+  // Primary backend is RTDB when enabled; BLE runs side-by-side. Chosen
+  // before any task starts; the backends themselves are started later.
 #if BUILD_ENABLE_RTDB
   remote_ = &rtdb_;
 #elif BUILD_ENABLE_BLE
@@ -401,52 +468,50 @@ void Application::initializeCloud() {
 #else
   remote_ = nullptr;
 #endif
-  struct RelayThunk { static void call(bool on, void* ctx) {
-    Application* self = static_cast<Application*>(ctx);
-    if (!self) return;
-    // Map remote boolean directly to hardware state:
-    // true -> pin HIGH (LED ON when active-high), false -> pin LOW (LED OFF)
-    bool hwOn = on;
-    bool wasOn = self->relay_.isOn();
-    self->relay_.setOn(hwOn);
-    Logger::info("Relay set %s via RTDB", hwOn ? "ON" : "OFF");
-    // Do NOT write back to the same path here; that would create a feedback loop
-    // where our write triggers the stream again and flips repeatedly.
-    // Mirror physical state so remote clients (cloud & BLE) can see the device result
-    if (self->remote_) self->remote_->publishRelayState(hwOn);
-#if BUILD_ENABLE_BLE
-    if (self->remote_ != static_cast<RemoteBackend*>(&self->ble_)) {
-      self->ble_.publishRelayState(hwOn);
-    }
-#endif
-    // Track for decision logs
-    self->lastCommandKnown_ = true;
-    self->lastCommandOn_ = on;
-    // Only record usage when the physical state actually changes
-    if (hwOn != wasOn) {
-      if (hwOn) self->recordUsageOn("command", "fromUser");
-      else self->recordUsageOff("command", "fromUser");
+  // Commands from either backend are queued to the control task, which owns
+  // the relay. Callbacks run on the network task (RTDB) or the NimBLE host
+  // task (BLE); they only enqueue, never touch the relay directly.
+  struct CommandThunk {
+    static void push(Application* self, bool on, RelayCommand::Source source) {
+      if (!self) return;
+      RelayCommand cmd;
+      cmd.on = on;
+      cmd.source = source;
+      if (!self->commandQ_.push(cmd)) {
+        Logger::warn("Tasks: command queue full (dropped=%u)", (unsigned)self->commandQ_.dropped());
+      }
+      self->notify(self->controlTask_);
     }
-  }};
+    static void rtdb(bool on, void* ctx) { push(static_cast<Application*>(ctx), on, RelayCommand::kRtdb); }
+    static void ble(bool on, void* ctx) { push(static_cast<Application*>(ctx), on, RelayCommand::kBle); }
+  };
 #if BUILD_ENABLE_RTDB
-  rtdb_.subscribeRelayCommand(&RelayThunk::call, this);
+  rtdb_.subscribeRelayCommand(&CommandThunk::rtdb, this);
 #endif
 #if BUILD_ENABLE_BLE
-  ble_.subscribeRelayCommand(&RelayThunk::call, this);
+  ble_.subscribeRelayCommand(&CommandThunk::ble, this);
 #endif
+}
 
-  // Settings subscriptions removed; we use pull-only ensure in runLoop()
+void Application::initializeBle() {
+  // BLE advertising starts right after local control, independent of Wi-Fi.
+#if BUILD_ENABLE_BLE
+  ble_.begin(&rtdbPaths_);
+  ble_.activate(true);
+  markBoot(BootTimeline::kBle);
+#endif
+}
 
-  // Activate all enabled backends so they can start processing (RTDB auth loop, BLE advertising).
+void Application::initializeCloud() {
+  // Runs on the network task (bringUpNetwork). Settings subscriptions
+  // removed; the network task pulls settings periodically.
 #if BUILD_ENABLE_RTDB
+  rtdb_.begin(&rtdbPaths_);
+  // Activate so it can start processing (RTDB auth loop).
   rtdb_.activate(true);
 #endif
-#if BUILD_ENABLE_BLE
-  ble_.activate(true);
-#endif
 }
 
 void Application::selectRemoteBackend() {
   // Compile-time flavor: backend chosen at init, no switching
 }
-
@@ -1,22 +1,45 @@
 // Application.h
 // High-level composition root for the GeyserSwitch firmware. Responsible for
-// initializing subsystems (logging, configuration) and driving the main loop.
+// initializing subsystems (logging, configuration) and starting the firmware
+// tasks. Work is split across FreeRTOS tasks that only talk through bounded
+// lock-free queues:
+// - sensor:  DS18B20 reads                          -> sensorQ_
+// - control: relay, schedules, safety cutoff, usage <- sensorQ_, commandQ_, settingsQ_
+//                                                   -> netOutQ_, bleOutQ_
+// - network: Wi-Fi, RTDB/primary backend, settings  <- netOutQ_ (via publishQ_) -> commandQ_, settingsQ_
+// - ble:     BLE mirror of state/telemetry          <- bleOutQ_ (NimBLE writes -> commandQ_)
+// Control decisions therefore never wait on TLS I/O.
 
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 
 #include "src/config/BuildConfig.h"
 #include "src/config/Pins.h"
 #include "src/config/Secrets.h"
 #include "src/config/RtdbPaths.h"
+#include "src/domain/SafetyMonitor.h"
+#include "src/domain/SamplingPolicy.h"
+#include "src/domain/Settings.h"
+#include "src/domain/TelemetryGate.h"
+#include "src/domain/TemperatureFilter.h"
+#include "src/domain/WindowAggregator.h"
 #include "src/infrastructure/Logger.h"
 #include "src/infrastructure/WifiManagerEsp32.h"
 #include "src/infrastructure/SystemClock.h"
 #include "src/infrastructure/DS18B20Sensor.h"
 #include "src/infrastructure/GpioRelay.h"
 #include "src/infrastructure/RemoteBackend.h"
-#include "src/config/BuildConfig.h"
+#include "src/infrastructure/UsageJournal.h"
+#include "src/infrastructure/WarmStateStore.h"
+#include "src/app/AppMessages.h"
+#include "src/app/BootTimeline.h"
+#include "src/app/MpscQueue.h"
+#include "src/app/PublishQueue.h"
+#include "src/app/Scheduler.h"
+#include "src/app/SpscQueue.h"
+#include "src/app/StoreForwardBuffer.h"
 #if BUILD_ENABLE_RTDB
 #include "src/infrastructure/RtdbClientMobizt.h"
 #endif
@@ -26,78 +49,232 @@
 
 class Application {
  public:
-  // Initializes logging and validates base configuration.
-  // Safe to call only once from Arduino setup().
+  // Initializes logging, subsystems and starts the firmware tasks in stages:
+  // relay/sensor/control first, then BLE; Wi-Fi, SNTP and cloud auth come up
+  // on the network task. Safe to call only once from Arduino setup().
   void begin();
 
-  // Runs a single iteration of the application's main loop. This function is
-  // designed to be non-blocking and is called repeatedly from Arduino loop().
+  // All work runs in the firmware tasks; the Arduino loop task just idles.
   void runLoop();
 
+  // When each boot stage completed (ms since reset).
+  const BootTimeline &bootTimeline() const { return boot_; }
+
  private:
   bool initialized_ = false;  // Tracks whether begin() was called
+  BootTimeline boot_;
 
   // Centralized RTDB path helper, rooted at basePath + "/" + userId.
   RtdbPaths rtdbPaths_;
-  WifiManagerEsp32 wifi_;
   SystemClock clock_;
+
+  // ---- Inter-task queues ----------------------------------------------------
+  SpscQueue<TempSample, BUILD_QUEUE_SENSOR_DEPTH> sensorQ_;            // sensor -> control
+  MpscQueue<RelayCommand, BUILD_QUEUE_COMMAND_DEPTH> commandQ_;        // network, NimBLE -> control
+  SpscQueue<SettingsSnapshot, BUILD_QUEUE_SETTINGS_DEPTH> settingsQ_;  // network -> control
+  SpscQueue<OutboundEvent, BUILD_QUEUE_OUTBOUND_DEPTH> netOutQ_;       // control -> network
+  MpscQueue<OutboundEvent, BUILD_QUEUE_OUTBOUND_DEPTH> bleOutQ_;       // control, network -> ble
+
+  TaskHandle_t sensorTask_ = nullptr;
+  TaskHandle_t controlTask_ = nullptr;
+  TaskHandle_t networkTask_ = nullptr;
+  TaskHandle_t bleTask_ = nullptr;
+
+  // Relay state published by control (full vs safety-probe-only cycles).
+  std::atomic<bool> relayOnShared_{false};
+  // Sample period chosen by control's SamplingPolicy, applied by the sensor task.
+  std::atomic<uint32_t> samplePeriodShared_{BUILD_TEMP_PERIOD_MS};
+  // DS18B20 TH alarm (whole degrees) derived by control from max_temp - hysteresis.
+  std::atomic<int> alarmHighShared_{68};
+
+  // ---- Sensor task state ----------------------------------------------------
+  Scheduler sensorSched_;
+  int tempJob_ = Scheduler::kInvalidJob;
   DS18B20Sensor temp_;
-  GpioRelay relay_;
-#if BUILD_ENABLE_RTDB
-  RtdbClientMobizt rtdb_;
-#endif
-#if BUILD_ENABLE_BLE
-  BleBackendNimble ble_;
-#endif
-  RemoteBackend* remote_ = nullptr;  // active remote (RTDB now, BLE later)
-  // Settings and command/state are kept in RAM only; no local flash/RTC persistence.
-  // Last command seen via stream (for decision logs)
-  bool lastCommandKnown_ = false;
-  bool lastCommandOn_ = false;
-  // Temperature smoothing/backoff
-  bool haveSmoothedTemp_ = false;
-  float smoothedTempC_ = 0.0f;
+  uint32_t tempCycleStartMs_ = 0;  // start of the current sample cycle (keeps cadence)
+  uint32_t lastFullSampleMs_ = 0;  // last all-probe readout (telemetry due check)
+  uint32_t lastSafetyReadMs_ = 0;  // last valid safety-probe readout (alarm search trust)
+  bool fullCycle_ = true;          // current conversion covers all probes (vs safety probe only)
+  uint32_t alarmScreenedSkips_ = 0; // fast cycles resolved by alarm search alone
   int tempFailCount_ = 0;
   uint32_t nextTempReadAllowedMs_ = 0;
+  bool probesMissing_ = false;     // last full cycle lost a known probe
+  uint32_t nextProbeScanMs_ = 0;
+  uint32_t probeScanBackoffMs_ = BUILD_DS18B20_RESCAN_MIN_MS;
+  uint32_t probeDiscoverBackoffMs_ = BUILD_DS18B20_RESCAN_MAX_MS;  // free roles, nothing missing
 
-  // Settings cache (max temp and timers subset)
-  struct SettingsCache {
-    float maxTempC = 70.0f;  // default safety cutoff
-    float hysteresisC = 2.0f; // default re-enable buffer
-    String customTime;       // "HH:MM" for CUSTOM
-    // Standard timer flags (enable windows starting at HH:MM)
-    bool t0400 = false;
-    bool t0600 = false;
-    bool t0800 = false;
-    bool t1600 = false;
-    bool t1800 = false;
-  } settings_;
-
+  // ---- Control task state ---------------------------------------------------
+  Scheduler controlSched_;
+  GpioRelay relay_;
+  SafetyMonitor safety_;       // fast-path cutoff with its own threshold copy
+  // The bound safety probe is off the bus: heating stays locked out until it
+  // answers again (other probes never stand in for the cutoff).
+  bool safetyProbeMissing_ = false;
+  SamplingPolicy sampling_;    // adaptive DS18B20 cadence
+  // Settings and command/state live in RAM, mirrored to RTC memory (warm_) so
+  // a soft reset resumes them; usage cycles are also journaled to flash by
+  // the network task (journal_).
+  SettingsSnapshot settings_;  // latest snapshot received from the network task
+  // Last command seen via remote (for decision logs)
+  bool lastCommandKnown_ = false;
+  bool lastCommandOn_ = false;
+  // Temperature filter chain (median -> EMA/Kalman -> slope) on the safety probe
+  TemperatureFilter tempFilter_;
+  bool tempUpdated_ = false;  // new sample since the last control pass (decision log)
+  // Deadband + heartbeat gate per probe: unchanged temperatures are not re-published.
+  TelemetryGate tempGates_[BUILD_DS18B20_MAX_PROBES];
+  // Every raw safety-probe sample folded into wall-clock windows (history upload).
+  WindowAggregator tempWindow_;
   // Schedule trigger state (per day): prevents re-firing the same start
   // Bits: 0=04:00, 1=06:00, 2=08:00, 3=16:00, 4=18:00, 5=CUSTOM
   int lastScheduleYDay_ = -1;
   uint32_t scheduleFiredMask_ = 0;
+  // Open usage cycle (0 = none); the id is millis() at cycle start.
+  uint32_t openCycleId_ = 0;
+  uint32_t openCycleStartMs_ = 0;
+  uint32_t openCycleStartSec_ = 0;  // clock_.now() at cycle start (survives a warm restart)
+  // Cycle left open by a reset (from the journal at boot); closed once the clock is set.
+  bool recoveredCycleOpen_ = false;
+  UsageJournal::Entry recoveredCycle_;
+  WarmStateStore warm_;
+
+  // ---- Network task state ---------------------------------------------------
+  Scheduler networkSched_;
+  WifiManagerEsp32 wifi_;
+#if BUILD_ENABLE_RTDB
+  RtdbClientMobizt rtdb_;
+#endif
+  RemoteBackend* remote_ = nullptr;  // active remote (RTDB now, BLE later)
+  SettingsSnapshot netSettings_;     // defaults/last values used for ensure calls
+  PublishQueue publishQ_;            // prioritised, coalesced staging for remote writes
+  // Usage records captured while offline, replayed in order after reconnect.
+  // Coalescible values (relay, temperature, LastUpdate) just wait in publishQ_.
+  StoreForwardBuffer<OutboundEvent, BUILD_OFFLINE_BUFFER_DEPTH> offlineBuf_;
+  bool networkOnline_ = false;
+  uint32_t lastReplayMs_ = 0;
+  // Closed temperature windows awaiting the next Records/Temperature upload.
+  StoreForwardBuffer<OutboundEvent, BUILD_TEMP_WINDOW_BUFFER> tempWindows_;
+  // Every window (mean + relay) kept compressed for about a week. Appended
+  // here; the BLE task reads it through its own cursor.
+  CompressedHistory history_;
+  uint32_t lastWindowSentSec_ = 0;    // newest window uploaded
+  uint32_t windowsDroppedSeen_ = 0;   // tempWindows_ drops already backfilled
+  CompressedHistory::Cursor backfill_;  // gap left by dropped windows
+  // Usage records stay in the flash journal until the write batch carrying
+  // them is confirmed; a failed batch puts its records back into offlineBuf_.
+  UsageJournal journal_;
+  struct JournalAck {
+    Application* app = nullptr;
+    bool used = false;
+    uint8_t count = 0;
+    uint32_t seqs[BUILD_PUBLISH_MAX_PER_FLUSH + BUILD_OFFLINE_REPLAY_BATCH];
+  };
+  JournalAck journalAcks_[BUILD_JOURNAL_ACK_SLOTS];
+  JournalAck* batchAck_ = nullptr;  // collects seqs while a batch is being built
+  uint32_t usageDeferred_ = 0;      // flushes that held usage records back (no free ack slot)
+  // Cycles already added to the BLE usage total (ring, oldest overwritten).
+  static constexpr uint8_t kBleCountedCycles = 16;
+  uint32_t bleCountedCycles_[kBleCountedCycles] = {};
+  uint8_t bleCountedNext_ = 0;
+  // Settings revision of the last full fetch; unchanged revisions skip the fetch.
+  bool settingsRevKnown_ = false;
+  uint32_t settingsRev_ = 0;
+  uint32_t lastFullSettingsMs_ = 0;
+  uint32_t settingsRevHits_ = 0;
+  uint32_t settingsRevMisses_ = 0;
+  uint32_t settingsSkipped_ = 0;  // syncs skipped while the backend was unhealthy
+
+  // ---- BLE task state -------------------------------------------------------
+#if BUILD_ENABLE_BLE
+  Scheduler bleSched_;
+  BleBackendNimble ble_;
+  CompressedHistory::Cursor bleHistory_;  // range requested over CHAR_HISTORY
+#endif
 
   // Internal helpers
   void initializeLogger();
   void loadStaticConfig();  // loads basePath/userId from Secrets into rtdbPaths_
-  void initializeWifiAndTime();
+  void bindRemoteBackends();  // primary backend + command callbacks (no I/O)
+  void initializeBle();
+  void bringUpNetwork();      // network task start: Wi-Fi, SNTP, RTDB client
   void initializeCloud();
   void selectRemoteBackend();
   void initializeSensorsAndActuators();
+  void restoreWarmState();    // relay, filter, schedules, open cycle from before a soft reset
+  void initializeJobs();
+  void startLocalTasks();     // control + sensor
+  void startBleTask();
+  void startNetworkTask();
+  void controlStarted();
+  bool markBoot(BootTimeline::Stage stage);
+  void trackNetworkBoot();
+  void logBootTimeline();
+  bool mirrorToBle() const;
+  bool remoteIsBle() const;  // BLE-only flavor: ble_ is the primary backend
+
+  // Task bodies: run due jobs, drain inbound queues, sleep until the next
+  // deadline or a queue notification.
+  struct TaskContext {
+    Application* app = nullptr;
+    Scheduler* sched = nullptr;
+    void (Application::*drain)() = nullptr;  // optional inbox handler
+    void (Application::*start)() = nullptr;  // optional, runs once before the first pass
+  };
+  TaskContext sensorCtx_, controlCtx_, networkCtx_, bleCtx_;
+  static void taskEntry(void* arg);
+  void runTask(const TaskContext &ctx);
+  void notify(TaskHandle_t task) { if (task) xTaskNotifyGive(task); }
+  void drainControlInbox();
+  void drainNetworkOutbox();
+  void drainBleOutbox();
+
+  // Sensor task jobs (non-blocking conversion state machine)
+  void sampleTemperature(uint32_t nowMs);
+  void finishTempSample(uint32_t nowMs, const DS18B20Sensor::Readings &readings, bool ok);
+  void applySensorConfig();
+  void rescanProbes(uint32_t nowMs);
+
+  // Control task jobs/handlers
+  void handleTempSample(const TempSample &sample);
+  void setSafetyProbeMissing(bool missing);
+  void handleRelayCommand(const RelayCommand &cmd);
+  void applySettings(const SettingsSnapshot &snap);
+  bool enforceSafety(float tempC, uint32_t sampleMs, const char* source);
+  void evaluateControl(uint32_t nowMs);
+  void setRelay(bool on);
+  void updateSamplingRate();
+  void recordTempWindow(float tempC);
+  void emit(const OutboundEvent &ev);
+  void persistControlState();
+
+  // Network task jobs/handlers
+  void serviceConnectivity(uint32_t nowMs);
+  void syncSettings(uint32_t nowMs);
+  void publishHeartbeat(uint32_t nowMs);
+  void flushPublishQueue(uint32_t nowMs);
+  void uploadTempWindows(uint32_t nowMs);
+  bool updateOnlineState();
+  void executeOutbound(const OutboundEvent &ev);
+  void restoreUsageJournal();
+  void journalUsage(OutboundEvent &ev);
+  JournalAck* acquireJournalAck();
+  void settleJournalAck(JournalAck &slot, bool ok);
+
+  // BLE task jobs/handlers
+  void serviceBle(uint32_t nowMs);
+  void executeBleOutbound(const OutboundEvent &ev);
 
   // Schedule helpers
-  static int parseHhmmToMinutes(const String &hhmm);
+  static int parseHhmmToMinutes(const char* hhmm);
   void processScheduleTriggers(bool haveTemp, float tempC);
-  // Usage logging (remote only; no local persistence)
+  // Usage logging (remote, backed by the flash journal until uploaded)
   void recordUsageOn(const char* reason, const char* instruction);
   void recordUsageOff(const char* reason, const char* instruction);
-  String usageDayPath() const;
-  String currentTimeStr() const;
-  String currentDateStr() const;
-  String openCycleId_ = String();
-  uint32_t openCycleStartMs_ = 0;
-  void addUsageToDailyTotal(uint32_t durationSec);
+  void closeRecoveredCycle();
+  static void formatLocalTime(char* buf, size_t len, const char* fmt, const char* fallback);
+  String usageDayPath(const char* isoDate) const;
+  String usageCyclePath(const char* isoDate, uint32_t cycleId) const;
+  bool resolveUsageTotal(OutboundEvent &ev);
+  void addUsageToDailyTotal(const OutboundEvent &end);
+  bool markBleCounted(uint32_t cycleId);
 };
-
-
@@ -0,0 +1,407 @@
+// ApplicationControl.cpp
+// Control task: owns the relay, schedule triggers, the safety cutoff and the
+// open usage cycle. Never performs network I/O; results are emitted as
+// OutboundEvents for the network and BLE tasks.
+
+#include "Application.h"
+#include <time.h>
+#include "src/domain/ControlPolicy.h"
+
+void Application::drainControlInbox() {
+  // Commands first: they are what the user is waiting on.
+  RelayCommand cmd;
+  while (commandQ_.pop(cmd)) handleRelayCommand(cmd);
+  SettingsSnapshot snap;
+  while (settingsQ_.pop(snap)) applySettings(snap);
+  TempSample sample;
+  while (sensorQ_.pop(sample)) handleTempSample(sample);
+  persistControlState();
+}
+
+void Application::applySettings(const SettingsSnapshot &snap) {
+  settings_ = snap;
+  safety_.setThreshold(settings_.maxTempC);
+  // TH alarm at the re-enable threshold: inside the hysteresis band every
+  // fast sample is read out in full; below it the alarm search suffices.
+  const int high = (int)floorf(safety_.threshold() - settings_.hysteresisC);
+  if (alarmHighShared_.exchange(high, std::memory_order_relaxed) != high) notify(sensorTask_);
+  updateSamplingRate();
+}
+
+void Application::handleTempSample(const TempSample &sample) {
+  if (sample.safetyMissing != safetyProbeMissing_) setSafetyProbeMissing(sample.safetyMissing);
+  // Failed reads keep the previous filtered value (the sensor task logs and backs off).
+  if (!sample.ok) return;
+  const float tC = sample.tempC;
+  // Safety first, on the hottest raw reading: no smoothing lag, no waiting on anything else.
+  float hottest = tC;
+  for (uint8_t p = 0; p < BUILD_DS18B20_MAX_PROBES; p++) {
+    if ((sample.probeOkMask & (1u << p)) && sample.probeC[p] > hottest) hottest = sample.probeC[p];
+  }
+  enforceSafety(hottest, sample.capturedMs, "sample");
+  markBoot(BootTimeline::kFirstSample);
+  // Filter chain: median rejects single-sample spikes, then EMA/Kalman smoothing
+  // and the rate of rise. We publish the raw reading for transparency but use
+  // the filtered value (and its prediction) for control decisions.
+  const TemperatureFilter::Output &f = tempFilter_.update(tC, sample.capturedMs);
+  tempUpdated_ = true;
+  recordTempWindow(tC);
+  sampling_.observe(f.filteredC);
+  updateSamplingRate();
+  uint32_t published = 0, suppressed = 0;
+  for (const auto &g : tempGates_) {
+    published += g.stats().published;
+    suppressed += g.stats().suppressed;
+  }
+  Logger::info("Temp: %.2f C (filtered=%.2f, slope=%+.2f C/min, conv=%ums, probes=0x%02x, tx=%u, skipped=%u)", tC,
+               f.filteredC, f.slopeCPerMin, (unsigned)sample.conversionMs, (unsigned)sample.probeOkMask,
+               (unsigned)published, (unsigned)suppressed);
+  // Telemetry only when a probe moved past the deadband (raw or, for the
+  // safety probe, filtered) or its heartbeat is due; goes to RTDB and BLE alike.
+  for (uint8_t p = 0; p < BUILD_DS18B20_MAX_PROBES; p++) {
+    if ((sample.probeOkMask & (1u << p)) == 0) continue;
+    const float smoothed = p == 0 ? f.filteredC : sample.probeC[p];
+    if (!tempGates_[p].shouldPublish(sample.probeC[p], smoothed, sample.capturedMs)) continue;
+    OutboundEvent ev;
+    ev.kind = OutboundEvent::kTempC;
+    ev.probe = p;
+    ev.tempC = sample.probeC[p];
+    emit(ev);
+  }
+  // Evaluate the cutoff against the fresh sample right away.
+  evaluateControl(millis());
+}
+
+void Application::setSafetyProbeMissing(bool missing) {
+  safetyProbeMissing_ = missing;
+  if (!missing) {
+    Logger::info("Control: safety probe back, heating allowed");
+    return;
+  }
+  Logger::error("Control: safety probe missing, heating locked out");
+  if (!relay_.isOn()) return;
+  setRelay(false);
+  recordUsageOff("safetyProbe", "fromDevice");
+}
+
+bool Application::enforceSafety(float tempC, uint32_t sampleMs, const char* source) {
+  if (!safety_.check(tempC) || !relay_.isOn()) return false;
+  setRelay(false);
+  safety_.recordTrip(sampleMs, millis());
+  const SafetyMonitor::Stats &st = safety_.stats();
+  Logger::warn("Control: target temperature cutoff (%s) at %.2f >= %.2f -> OFF (latency=%ums, max=%ums, trips=%u)",
+               source, tempC, safety_.threshold(), (unsigned)st.lastLatencyMs,
+               (unsigned)st.maxLatencyMs, (unsigned)st.trips);
+  recordUsageOff("targetTemp", "fromDevice");
+  return true;
+}
+
+void Application::handleRelayCommand(const RelayCommand &cmd) {
+  // Map remote boolean directly to hardware state:
+  // true -> pin HIGH (LED ON when active-high), false -> pin LOW (LED OFF)
+  // No cutoff without the safety probe: ON is refused (the OFF state is
+  // still published so the remote sees the refusal).
+  const bool hwOn = cmd.on && !safetyProbeMissing_;
+  if (cmd.on && !hwOn) Logger::warn("Control: ON refused, safety probe missing");
+  const bool wasOn = relay_.isOn();
+  // Do NOT write back to the command path; that would create a feedback loop
+  // where our write triggers the remote again and flips repeatedly. setRelay()
+  // mirrors the physical state so remote clients (cloud & BLE) see the result.
+  setRelay(hwOn);
+  Logger::info("Relay set %s via %s", hwOn ? "ON" : "OFF", cmd.source == RelayCommand::kBle ? "BLE" : "RTDB");
+  // Track for decision logs
+  lastCommandKnown_ = true;
+  lastCommandOn_ = cmd.on;
+  // Only record usage when the physical state actually changes
+  if (hwOn != wasOn) {
+    if (hwOn) recordUsageOn("command", "fromUser");
+    else recordUsageOff("command", "fromUser");
+  }
+}
+
+void Application::setRelay(bool on) {
+  relay_.setOn(on);
+  if (relayOnShared_.exchange(on, std::memory_order_relaxed) != on) {
+    updateSamplingRate();
+    notify(sensorTask_);
+  }
+  OutboundEvent ev;
+  ev.kind = OutboundEvent::kRelayState;
+  ev.on = on;
+  emit(ev);
+}
+
+void Application::updateSamplingRate() {
+  // Publish the effective cadence; the sensor task applies it between conversions.
+  const SamplingPolicy::Mode prev = sampling_.mode();
+  const uint32_t period = sampling_.evaluate(relay_.isOn(), safety_.threshold());
+  if (samplePeriodShared_.exchange(period, std::memory_order_relaxed) == period) return;
+  Logger::info("Sampling: period %ums (%s -> %s, %.2f Hz)", (unsigned)period,
+               SamplingPolicy::modeName(prev), SamplingPolicy::modeName(sampling_.mode()),
+               1000.0f / (float)period);
+  notify(sensorTask_);
+}
+
+void Application::emit(const OutboundEvent &ev) {
+  if (!netOutQ_.push(ev)) {
+    Logger::warn("Tasks: network queue full (dropped=%u)", (unsigned)netOutQ_.dropped());
+  }
+  notify(networkTask_);
+  if (mirrorToBle() && ev.kind != OutboundEvent::kUsageStart && ev.kind != OutboundEvent::kUsageEnd &&
+      ev.kind != OutboundEvent::kTempWindow) {
+    if (!bleOutQ_.push(ev)) {
+      Logger::warn("Tasks: BLE queue full (dropped=%u)", (unsigned)bleOutQ_.dropped());
+    }
+    notify(bleTask_);
+  }
+}
+
+void Application::recordTempWindow(float tempC) {
+  // Windows are keyed by wall-clock time, so nothing is recorded before SNTP sync.
+  const time_t now = clock_.now();
+  if (now <= 0) return;
+  WindowAggregator::Summary w;
+  if (!tempWindow_.add(tempC, (uint32_t)now, w)) return;
+  OutboundEvent ev;
+  ev.kind = OutboundEvent::kTempWindow;
+  ev.on = relay_.isOn();
+  ev.epochSec = w.startSec;
+  ev.tempC = w.lastC;
+  ev.windowC = {w.minC, w.maxC, w.meanC, w.lastC, w.count};
+  time_t start = (time_t)w.startSec;
+  struct tm lt;
+  if (!localtime_r(&start, &lt)) return;
+  strftime(ev.date, sizeof(ev.date), "%Y-%m-%d", &lt);
+  strftime(ev.time, sizeof(ev.time), "%H:%M", &lt);
+  emit(ev);
+}
+
+void Application::evaluateControl(uint32_t /*nowMs*/) {
+  const TemperatureFilter::Output &f = tempFilter_.output();
+  const bool haveTemp = f.valid;
+
+  closeRecoveredCycle();
+
+  // Fire schedule triggers at exact times (start-only), then safety will auto-OFF at maxTemp
+  processScheduleTriggers(haveTemp, f.filteredC);
+  bool scheduleActive = false; // triggers now manage ON; leave false here
+
+  // Control evaluation (command handled via queue for ON decisions)
+  ControlInputs ci{};
+  ci.hasCommand = false;        // commands set relay directly; no latched command cache yet
+  ci.commandOn = false;
+  ci.scheduleActive = scheduleActive;
+  // For control, prefer the filtered temperature (if available) to avoid
+  // rapid toggling near thresholds. If not available, use 0.0 which is
+  // interpreted alongside `haveTemp` checks below. The prediction looks one
+  // sample period ahead, which is how long the next decision is away.
+  ci.tempC = haveTemp ? f.filteredC : 0.0f;
+#if BUILD_TEMP_PREDICT
+  ci.hasPrediction = haveTemp;
+  ci.predictedTempC = tempFilter_.predict(samplePeriodShared_.load(std::memory_order_relaxed));
+#endif
+  ci.maxTempC = safety_.threshold();
+  ci.hysteresisC = settings_.hysteresisC;
+  ci.relayCurrentlyOn = relay_.isOn();
+
+  ControlDecision cd = ControlPolicy::evaluate(ci);
+  (void)cd;
+  // Only apply control if it would turn OFF due to safety; ON decisions are left to command/schedule
+  // Enforce safety cutoff only when we actually have a valid temperature reading.
+  const bool changed = haveTemp && ControlPolicy::cutoffRequired(ci) &&
+                       enforceSafety(ControlPolicy::effectiveTempC(ci), millis(),
+                                     ci.predictedTempC > ci.tempC ? "predicted" : "filtered");
+  persistControlState();
+
+  // Concise control decision log, once per new sample or state change
+  if (!tempUpdated_ && !changed) return;
+  tempUpdated_ = false;
+  const char* cmdStr = lastCommandKnown_ ? (lastCommandOn_ ? "ON" : "OFF") : "n/a";
+  Logger::info(
+    "Decision: cmd=%s, sched=%s, temp=%.1fC, predicted=%.1fC, hyst=%.1fC, state=%s, sample=%ums",
+    cmdStr,
+    (scheduleActive ? "ON" : "OFF"),
+    ci.tempC,
+    ControlPolicy::effectiveTempC(ci),
+    settings_.hysteresisC,
+    relay_.isOn() ? "ON" : "OFF",
+    (unsigned)samplePeriodShared_.load(std::memory_order_relaxed)
+  );
+}
+
+void Application::recordUsageOn(const char* reason, const char* instruction) {
+  openCycleId_ = millis();
+  openCycleStartMs_ = openCycleId_;
+  openCycleStartSec_ = (uint32_t)clock_.now();
+  OutboundEvent ev;
+  ev.kind = OutboundEvent::kUsageStart;
+  ev.cycleId = openCycleId_;
+  ev.epochSec = openCycleStartSec_;
+  ev.reason = reason;
+  ev.instruction = instruction;
+  formatLocalTime(ev.date, sizeof(ev.date), "%Y-%m-%d", "1970-01-01");
+  formatLocalTime(ev.time, sizeof(ev.time), "%H:%M", "00:00");
+  emit(ev);
+}
+
+void Application::recordUsageOff(const char* reason, const char* instruction) {
+  if (openCycleId_ == 0) return;
+  uint32_t dur = 0;
+  if (openCycleStartMs_ != 0) dur = (millis() - openCycleStartMs_) / 1000u;
+  OutboundEvent ev;
+  ev.kind = OutboundEvent::kUsageEnd;
+  ev.cycleId = openCycleId_;
+  ev.reason = reason;
+  ev.instruction = instruction;
+  ev.durationSec = dur;
+  ev.epochSec = (uint32_t)clock_.now();
+  formatLocalTime(ev.date, sizeof(ev.date), "%Y-%m-%d", "1970-01-01");
+  formatLocalTime(ev.time, sizeof(ev.time), "%H:%M", "00:00");
+  emit(ev);
+  openCycleId_ = 0;
+  openCycleStartMs_ = 0;
+  openCycleStartSec_ = 0;
+}
+
+void Application::closeRecoveredCycle() {
+  // Unless resumed by restoreWarmState(), the relay boots off, so a cycle the
+  // journal still has open ended at the reset. Its end is only known once the
+  // clock is set: the duration runs to now (an upper bound) and long outages
+  // are recorded as 0 instead.
+  if (!recoveredCycleOpen_) return;
+  const time_t now = clock_.now();
+  if (now <= 0) return;
+  recoveredCycleOpen_ = false;
+  const uint32_t startSec = recoveredCycle_.epochSec;
+  uint32_t dur = 0;
+  if (startSec && (uint32_t)now > startSec && (uint32_t)now - startSec <= BUILD_USAGE_RECOVERED_MAX_SEC) {
+    dur = (uint32_t)now - startSec;
+  }
+  OutboundEvent ev;
+  ev.kind = OutboundEvent::kUsageEnd;
+  ev.cycleId = recoveredCycle_.cycleId;
+  ev.epochSec = (uint32_t)now;
+  ev.reason = "reboot";
+  ev.instruction = "fromDevice";
+  ev.durationSec = dur;
+  strncpy(ev.date, recoveredCycle_.date, sizeof(ev.date) - 1);  // the cycle node lives under its start day
+  formatLocalTime(ev.time, sizeof(ev.time), "%H:%M", "00:00");
+  emit(ev);
+  Logger::info("Usage: closed cycle %u interrupted by reset (%us)", (unsigned)ev.cycleId, (unsigned)dur);
+}
+
+void Application::restoreWarmState() {
+  // Runs in begin() before the tasks start. After a cold boot there is
+  // nothing to restore and the relay stays off.
+  WarmStateStore::ControlState s;
+  if (!warm_.restore(s)) return;
+  netSettings_ = s.settings;
+  applySettings(s.settings);
+  if (s.haveTemp) tempFilter_.seed(s.filteredC);
+  lastScheduleYDay_ = s.scheduleYDay;
+  scheduleFiredMask_ = s.scheduleFiredMask;
+  const uint8_t chain = warm_.restartChain();
+  if (chain > BUILD_WARM_RESTART_MAX_CHAIN) {
+    // Resetting over and over, possibly because of the load itself: boot off
+    // and let the journal close the cycle, as after a cold boot.
+    Logger::warn("Warm restart (%s): %u resets in a row, relay left OFF", warm_.resetReason(), (unsigned)chain);
+    return;
+  }
+  if (s.relayOn) setRelay(true);
+  if (s.openCycleId) {
+    // The cycle goes on under its old id. Its age comes from the clock, which
+    // keeps counting through a soft reset (millis() does not).
+    openCycleId_ = s.openCycleId;
+    openCycleStartSec_ = s.openCycleStartSec;
+    const uint32_t now = (uint32_t)clock_.now();
+    uint32_t ageMs = 0;
+    if (s.openCycleStartSec && now >= s.openCycleStartSec &&
+        now - s.openCycleStartSec <= BUILD_USAGE_RECOVERED_MAX_SEC) {
+      ageMs = (now - s.openCycleStartSec) * 1000u;
+    }
+    openCycleStartMs_ = millis() - ageMs;
+    if (openCycleStartMs_ == 0) openCycleStartMs_ = 1;
+  }
+  Logger::info("Warm restart (%s): relay %s, filtered=%.2f C, schedules fired=0x%02x, open cycle=%u (chain=%u)",
+               warm_.resetReason(), relay_.isOn() ? "ON" : "OFF", s.haveTemp ? s.filteredC : 0.0f,
+               (unsigned)scheduleFiredMask_, (unsigned)openCycleId_, (unsigned)chain);
+}
+
+void Application::persistControlState() {
+  // End of every control pass; the store only writes when something changed.
+  WarmStateStore::ControlState s;
+  memset(static_cast<void*>(&s), 0, sizeof(s));  // padding is compared too
+  const TemperatureFilter::Output &f = tempFilter_.output();
+  s.relayOn = relay_.isOn() ? 1 : 0;
+  s.haveTemp = f.valid ? 1 : 0;
+  s.filteredC = f.valid ? f.filteredC : 0.0f;
+  s.scheduleYDay = lastScheduleYDay_;
+  s.scheduleFiredMask = scheduleFiredMask_;
+  s.openCycleId = openCycleId_;
+  s.openCycleStartSec = openCycleStartSec_;
+  memcpy(static_cast<void*>(&s.settings), &settings_, sizeof(s.settings));
+  warm_.save(s);
+  if (warm_.restartChain() && millis() >= BUILD_WARM_RESTART_STABLE_MS) warm_.markStable();
+}
+
+int Application::parseHhmmToMinutes(const char* hhmm) {
+  if (!hhmm || strlen(hhmm) != 5 || hhmm[2] != ':') return -1;
+  int hh = atoi(hhmm);
+  int mm = atoi(hhmm + 3);
+  if (hh < 0 || hh > 23 || mm < 0 || mm > 59) return -1;
+  return hh * 60 + mm;
+}
+
+// legacy window checker removed; triggers manage ON behavior
+
+void Application::processScheduleTriggers(bool haveTemp, float tempC) {
+  // Schedules are wall-clock times: nothing fires on the count-from-boot
+  // clock, and the day kept over a warm restart is not mistaken for a new one.
+  if (!clock_.isSynced()) return;
+  // Reset fired mask on new day
+  time_t nowSec = time(nullptr);
+  struct tm ltBuf;
+  struct tm *lt = localtime_r(&nowSec, &ltBuf);
+  if (!lt) return;
+  if (lastScheduleYDay_ != lt->tm_yday) {
+    lastScheduleYDay_ = lt->tm_yday;
+    scheduleFiredMask_ = 0;
+  }
+
+  auto maybeFire = [&](int bit, const char* hhmmFlag, bool enabled){
+    if (!enabled) return;
+    int startMin = parseHhmmToMinutes(hhmmFlag);
+    if (startMin < 0) return;
+    int nowMin = lt->tm_hour * 60 + lt->tm_min;
+    // Allow a 0..59s window since the control job ticks every few seconds; match on minute only
+    if (nowMin == startMin) {
+      if ((scheduleFiredMask_ & (1u << bit)) == 0) {
+        // Fire ON if below re-enable threshold
+        float reenable = settings_.maxTempC - settings_.hysteresisC; // hysteresis
+        if (safetyProbeMissing_) {
+          Logger::warn("Schedule: trigger %s skipped (safety probe missing)", hhmmFlag);
+        } else if (!haveTemp || tempC < reenable) {
+          setRelay(true);
+          if (haveTemp) {
+            Logger::info("Schedule: trigger %s -> ON (temp=%.1f < %.1f)", hhmmFlag, tempC, reenable);
+          } else {
+            Logger::info("Schedule: trigger %s -> ON (no temp yet)", hhmmFlag);
+          }
+          recordUsageOn("schedule", "fromDevice");
+        } else {
+          Logger::info("Schedule: trigger %s skipped (temp=%.1f >= %.1f)", hhmmFlag, tempC, reenable);
+        }
+        scheduleFiredMask_ |= (1u << bit);
+      }
+    }
+  };
+
+  maybeFire(0, "04:00", settings_.t0400);
+  maybeFire(1, "06:00", settings_.t0600);
+  maybeFire(2, "08:00", settings_.t0800);
+  maybeFire(3, "16:00", settings_.t1600);
+  maybeFire(4, "18:00", settings_.t1800);
+  if (settings_.hasCustomTime()) {
+    maybeFire(5, settings_.customTime, true);
+  }
+}
@@ -0,0 +1,425 @@
+// ApplicationNetwork.cpp
+// Network task: Wi-Fi, the primary RemoteBackend (RTDB or BLE-only flavor),
+// settings pull and execution of OutboundEvents emitted by the control task.
+// Everything here may block on TLS; nothing here touches the relay.
+
+#include "Application.h"
+#include <string.h>
+#include <time.h>
+
+// Journal entries store reason/instruction as text; events carry static literals.
+static const char* internUsageLiteral(const char* s) {
+  static const char* const kKnown[] = {"command", "schedule", "targetTemp", "safetyProbe", "reboot", "fromUser", "fromDevice"};
+  for (const char* k : kKnown) {
+    if (strcmp(s, k) == 0) return k;
+  }
+  return "unknown";
+}
+
+static OutboundEvent eventFromJournal(const UsageJournal::Entry &e) {
+  OutboundEvent ev;
+  ev.kind = e.kind == UsageJournal::kEnd ? OutboundEvent::kUsageEnd : OutboundEvent::kUsageStart;
+  ev.cycleId = e.cycleId;
+  ev.durationSec = e.durationSec;
+  ev.epochSec = e.epochSec;
+  ev.journalSeq = e.seq;
+  ev.redelivered = true;
+  ev.reason = internUsageLiteral(e.reason);
+  ev.instruction = internUsageLiteral(e.instruction);
+  strncpy(ev.date, e.date, sizeof(ev.date) - 1);
+  strncpy(ev.time, e.time, sizeof(ev.time) - 1);
+  return ev;
+}
+
+void Application::drainNetworkOutbox() {
+  // Stage everything from control (coalescing repeated values), then send
+  // what the rate limits allow right away. Each pass starts a fresh budget
+  // for the time the backend may block.
+  if (remote_) remote_->beginPass();
+  const bool online = updateOnlineState();
+  OutboundEvent ev;
+  bool staged = false;
+  while (netOutQ_.pop(ev)) {
+    if (ev.kind == OutboundEvent::kUsageStart || ev.kind == OutboundEvent::kUsageEnd) journalUsage(ev);
+    if (ev.kind == OutboundEvent::kTempWindow) {
+      history_.append(ev.epochSec, ev.windowC.meanC, ev.on);
+      tempWindows_.push(ev);  // uploaded together by the history job
+      continue;
+    }
+    if (!online && PublishQueue::classOf(ev) == PublishQueue::kUsage) {
+      offlineBuf_.push(ev);  // distinct records: keep every one for replay
+      continue;
+    }
+    if (!publishQ_.push(ev)) {
+      Logger::warn("Network: publish queue full, dropped kind=%u (dropped=%u)", (unsigned)ev.kind,
+                   (unsigned)publishQ_.stats().dropped);
+    }
+    staged = true;
+  }
+  if (staged) flushPublishQueue(millis());
+}
+
+bool Application::updateOnlineState() {
+  // Cloud writes only make sense with a link; otherwise they fail and the data is lost.
+  bool needsLink = false;
+#if BUILD_ENABLE_RTDB
+  needsLink = remote_ == &rtdb_;
+#endif
+  const bool online = remote_ && (!needsLink || wifi_.isConnected());
+  if (online == networkOnline_) return online;
+  networkOnline_ = online;
+  const auto &st = offlineBuf_.stats();
+  if (online) {
+    Logger::info("Network: online, replaying %u buffered (peak=%u, dropped=%u)", (unsigned)offlineBuf_.size(),
+                 (unsigned)st.highWater, (unsigned)st.dropped);
+  } else {
+    Logger::warn("Network: offline, buffering remote writes");
+  }
+  return online;
+}
+
+void Application::flushPublishQueue(uint32_t nowMs) {
+  // Each pass goes out as one write batch, so a relay transition (state +
+  // usage record) costs a single round trip; relay state is always first.
+  if (!updateOnlineState()) return;  // values wait in publishQ_/offlineBuf_
+  bool replayDue = !offlineBuf_.empty() && nowMs - lastReplayMs_ >= BUILD_OFFLINE_REPLAY_PERIOD_MS;
+  if (publishQ_.empty() && !replayDue) return;
+  // Journaled usage records only go out in a batch that can ack them. With
+  // every ack slot in flight they (and the replay) wait for a later pass;
+  // sent untracked they would stay pending and be replayed forever.
+  batchAck_ = acquireJournalAck();
+  uint8_t classMask = 0xFF;
+  if (journal_.ready() && !batchAck_) {
+    classMask &= (uint8_t)~(1u << PublishQueue::kUsage);
+    replayDue = false;
+    usageDeferred_++;
+  }
+  struct Thunk {
+    static void send(const OutboundEvent &ev, void* ctx) { static_cast<Application*>(ctx)->executeOutbound(ev); }
+    static void settled(bool ok, void* ctx) {
+      auto *slot = static_cast<JournalAck*>(ctx);
+      slot->app->settleJournalAck(*slot, ok);
+    }
+  };
+  remote_->beginBatch();
+  uint8_t sent = publishQ_.drain(nowMs, &Thunk::send, this, BUILD_PUBLISH_MAX_PER_FLUSH, classMask);
+  // Replay rides behind live traffic, a few records per period, so a long
+  // outage never starves fresh relay/usage writes.
+  if (replayDue) {
+    lastReplayMs_ = nowMs;
+    OutboundEvent ev;
+    for (uint8_t i = 0; i < BUILD_OFFLINE_REPLAY_BATCH && offlineBuf_.pop(ev); i++, sent++) {
+      if (!resolveUsageTotal(ev)) {
+        offlineBuf_.push(ev);  // could not tell whether it landed; next period
+        break;
+      }
+      executeOutbound(ev);
+    }
+    if (offlineBuf_.empty()) {
+      Logger::info("Network: offline replay done (stored=%u, dropped=%u)", (unsigned)offlineBuf_.stats().stored,
+                   (unsigned)offlineBuf_.stats().dropped);
+    }
+  }
+  JournalAck* ack = batchAck_;
+  batchAck_ = nullptr;
+  bool ok;
+  if (ack && ack->count) {
+    ok = remote_->commitBatchWithAck(&Thunk::settled, ack);
+  } else {
+    if (ack) ack->used = false;
+    ok = remote_->commitBatch();
+  }
+  if (!ok) Logger::warn("Network: outbound batch of %u failed", (unsigned)sent);
+  if (classMask != 0xFF) {
+    Logger::debug("Network: usage records held until a batch is confirmed (held=%u)", (unsigned)usageDeferred_);
+  }
+}
+
+void Application::uploadTempWindows(uint32_t /*nowMs*/) {
+  // All closed windows in one multi-location update:
+  // Records/Temperature/<date>/<HH:MM> = {min, max, mean, last, n, relay}.
+  if ((tempWindows_.empty() && backfill_.done()) || !updateOnlineState()) return;
+  static const char* const kKeys[] = {"min", "max", "mean", "last", "n", "relay"};
+  // Windows dropped from the buffer during an outage are still in history_:
+  // fill the gap between the last upload and the oldest buffered window.
+  // Not over BLE: its history characteristic belongs to the BLE task, and a
+  // BLE client asks for the range it is missing itself.
+  const bool backfillAllowed = !remoteIsBle();
+  const uint32_t dropped = tempWindows_.stats().dropped;
+  const bool gap = dropped != windowsDroppedSeen_;
+  windowsDroppedSeen_ = dropped;
+  remote_->beginBatch();
+  // Windows stay buffered (and lastWindowSentSec_ stays put) until the batch
+  // is confirmed, so a failed commit is retried on the next run.
+  OutboundEvent ev;
+  uint16_t windows = 0;
+  uint32_t newestSec = lastWindowSentSec_;
+  while (tempWindows_.peek(windows, ev)) {
+    if (windows == 0 && gap && backfillAllowed && lastWindowSentSec_ && ev.epochSec > lastWindowSentSec_ + 1) {
+      // A backfill still in progress is folded into the new range.
+      uint32_t from = lastWindowSentSec_ + 1;
+      if (!backfill_.done() && backfill_.pendingFromSec() < from) from = backfill_.pendingFromSec();
+      backfill_ = history_.query(from, ev.epochSec - 1);
+    }
+    const float values[] = {ev.windowC.minC, ev.windowC.maxC, ev.windowC.meanC, ev.windowC.lastC,
+                            (float)ev.windowC.count, ev.on ? 1.0f : 0.0f};
+    remote_->batchSetNumbers(rtdbPaths_.temperatureDay(String(ev.date)) + "/" + ev.time, kKeys, values, 6);
+    newestSec = ev.epochSec;
+    windows++;
+  }
+  uint16_t count = windows;
+  // The backfill cursor advances as it streams; remember where this pass
+  // started so a failed commit can re-read the same points.
+  const bool backfilling = !backfill_.done();
+  const uint32_t backfillFrom = backfill_.pendingFromSec();
+  const uint32_t backfillTo = backfill_.toSec();
+  if (backfilling) {
+    const uint16_t sent = remote_->streamHistory(backfill_, BUILD_HISTORY_STREAM_MAX);
+    if (sent == 0) backfill_ = CompressedHistory::Cursor();  // backend has no history channel
+    count += sent;
+  }
+  if (!remote_->commitBatch()) {
+    if (count > windows) backfill_ = history_.query(backfillFrom, backfillTo);
+    Logger::warn("History: upload of %u points failed (kept %u windows)", (unsigned)count, (unsigned)tempWindows_.size());
+  } else {
+    tempWindows_.discard(windows);
+    lastWindowSentSec_ = newestSec;
+    Logger::info("History: uploaded %u points (dropped=%u, stored=%u in %u B)", (unsigned)count, (unsigned)dropped,
+                 (unsigned)history_.stats().points, (unsigned)history_.stats().bytesUsed);
+  }
+}
+
+void Application::restoreUsageJournal() {
+  // Runs in begin() before the tasks start: unconfirmed records are queued
+  // for replay and a cycle cut short by the reset is handed to control.
+  if (!journal_.begin()) return;
+  struct Visit {
+    static void pending(const UsageJournal::Entry &e, void* ctx) {
+      static_cast<Application*>(ctx)->offlineBuf_.push(eventFromJournal(e));
+    }
+  };
+  journal_.forEachPending(&Visit::pending, this);
+  recoveredCycleOpen_ = journal_.openCycle(recoveredCycle_);
+  // A cycle resumed from the warm-restart snapshot did not end at the reset.
+  if (recoveredCycleOpen_ && openCycleId_ != 0 && recoveredCycle_.cycleId == openCycleId_) {
+    recoveredCycleOpen_ = false;
+  }
+}
+
+void Application::journalUsage(OutboundEvent &ev) {
+  if (!journal_.ready()) return;
+  UsageJournal::Entry e;
+  e.kind = ev.kind == OutboundEvent::kUsageEnd ? UsageJournal::kEnd : UsageJournal::kStart;
+  e.cycleId = ev.cycleId;
+  e.durationSec = ev.durationSec;
+  e.epochSec = ev.epochSec;
+  strncpy(e.date, ev.date, sizeof(e.date) - 1);
+  strncpy(e.time, ev.time, sizeof(e.time) - 1);
+  strncpy(e.reason, ev.reason, sizeof(e.reason) - 1);
+  strncpy(e.instruction, ev.instruction, sizeof(e.instruction) - 1);
+  if (journal_.append(e)) {
+    ev.journalSeq = e.seq;
+  } else {
+    Logger::warn("Journal: append failed (errors=%u)", (unsigned)journal_.stats().writeErrors);
+  }
+}
+
+Application::JournalAck* Application::acquireJournalAck() {
+  if (!journal_.ready()) return nullptr;
+  for (auto &slot : journalAcks_) {
+    if (slot.used) continue;
+    slot.app = this;
+    slot.used = true;
+    slot.count = 0;
+    return &slot;
+  }
+  return nullptr;
+}
+
+void Application::settleJournalAck(JournalAck &slot, bool ok) {
+  if (ok) {
+    for (uint8_t i = 0; i < slot.count; i++) journal_.ack(slot.seqs[i]);
+  } else {
+    // Not confirmed: replay the batch's records from the journal. A timed-out
+    // write may still have landed, so delivery is at-least-once.
+    struct Visit {
+      static void pending(const UsageJournal::Entry &e, void* ctx) {
+        auto *s = static_cast<JournalAck*>(ctx);
+        for (uint8_t i = 0; i < s->count; i++) {
+          if (s->seqs[i] == e.seq) {
+            s->app->offlineBuf_.push(eventFromJournal(e));
+            break;
+          }
+        }
+      }
+    };
+    journal_.forEachPending(&Visit::pending, &slot);
+    Logger::warn("Journal: batch not confirmed, %u usage records requeued", (unsigned)slot.count);
+  }
+  slot.used = false;
+  slot.count = 0;
+}
+
+void Application::serviceConnectivity(uint32_t /*nowMs*/) {
+  wifi_.ensureConnected();
+  // Maintain active remote backend (cloud). BLE is serviced by its own task.
+  selectRemoteBackend();
+  if (remote_) remote_->loop();
+  if (!boot_.reached(BootTimeline::kCloudUp)) trackNetworkBoot();
+}
+
+void Application::syncSettings(uint32_t nowMs) {
+  // Cheap revision probe first: an unchanged revision means control already
+  // has these settings. A periodic full fetch covers writers that forget to bump it.
+  // An unhealthy backend would only make every GET wait for its timeout;
+  // control keeps the last snapshot until the next period.
+  if (remote_ && !remote_->isHealthy()) {
+    settingsSkipped_++;
+    return;
+  }
+  uint32_t rev = 0;
+  const bool haveRev = remote_ && remote_->fetchSettingsRevision(rev);
+  if (haveRev && settingsRevKnown_ && rev == settingsRev_ &&
+      nowMs - lastFullSettingsMs_ < BUILD_SETTINGS_FULL_REFRESH_MS) {
+    settingsRevHits_++;
+    return;
+  }
+  settingsRevMisses_++;
+  // Pull settings in bulk (creating missing defaults), then hand a snapshot to control.
+  // Defaults: last known values, except timers which are created disabled.
+  SettingsSnapshot defaults = netSettings_;
+  defaults.t0400 = defaults.t0600 = defaults.t0800 = defaults.t1600 = defaults.t1800 = false;
+  SettingsSnapshot fetched;
+  if (!remote_ || !remote_->fetchSettings(defaults, fetched)) {
+    Logger::warn("Settings: fetch failed");
+  } else {
+    netSettings_ = fetched;
+    settingsRevKnown_ = haveRev;
+    settingsRev_ = rev;
+    lastFullSettingsMs_ = nowMs;
+    if (haveRev) {
+      Logger::info("Settings: revision %u fetched (hits=%u, misses=%u, skipped=%u)", (unsigned)rev,
+                   (unsigned)settingsRevHits_, (unsigned)settingsRevMisses_, (unsigned)settingsSkipped_);
+    }
+  }
+#if BUILD_LOG_SETTINGS_VERBOSE
+  Logger::warn(
+    "Timers: { 04:00: %s, 06:00: %s, 08:00: %s, 16:00: %s, 18:00: %s, CUSTOM: %s }",
+    netSettings_.t0400 ? "true" : "false",
+    netSettings_.t0600 ? "true" : "false",
+    netSettings_.t0800 ? "true" : "false",
+    netSettings_.t1600 ? "true" : "false",
+    netSettings_.t1800 ? "true" : "false",
+    netSettings_.customTime
+  );
+  Logger::warn("Max-T: Target Temperature = %.0f'C (hyst=%.1fC)", netSettings_.maxTempC, netSettings_.hysteresisC);
+#endif
+  if (!settingsQ_.push(netSettings_)) {
+    Logger::warn("Tasks: settings queue full (dropped=%u)", (unsigned)settingsQ_.dropped());
+  }
+  notify(controlTask_);
+}
+
+void Application::publishHeartbeat(uint32_t nowMs) {
+  // Periodic LastUpdate write (time/date)
+  if (clock_.now() <= 0) return;
+  OutboundEvent ev;
+  ev.kind = OutboundEvent::kLastUpdate;
+  formatLocalTime(ev.time, sizeof(ev.time), "%H:%M:%S", "00:00:00");
+  formatLocalTime(ev.date, sizeof(ev.date), "%Y-%m-%d", "1970-01-01");
+  if (!publishQ_.push(ev)) Logger::warn("Network: publish queue full, heartbeat dropped");
+  flushPublishQueue(nowMs);
+  if (mirrorToBle()) {
+    bleOutQ_.push(ev);
+    notify(bleTask_);
+  }
+}
+
+void Application::executeOutbound(const OutboundEvent &ev) {
+  if (!remote_) return;
+  // Journaled usage records are acknowledged when the batch is confirmed.
+  const size_t ackCap = sizeof(JournalAck::seqs) / sizeof(JournalAck::seqs[0]);
+  if (batchAck_ && ev.journalSeq && batchAck_->count < ackCap) batchAck_->seqs[batchAck_->count++] = ev.journalSeq;
+  switch (ev.kind) {
+    case OutboundEvent::kTempC:
+      remote_->publishProbeTempC(ev.probe, ev.tempC);
+      break;
+    case OutboundEvent::kRelayState:
+      remote_->publishRelayState(ev.on);
+      break;
+    case OutboundEvent::kLastUpdate:
+      remote_->publishLastUpdate(String(ev.time), String(ev.date));
+      break;
+    case OutboundEvent::kUsageStart: {
+      const String base = usageCyclePath(ev.date, ev.cycleId);
+      remote_->batchSetString(base + "startTime", String(ev.time));
+      remote_->batchSetString(base + "startReason", String(ev.reason));
+      remote_->batchSetString(base + "startInstruction", String(ev.instruction));
+      break;
+    }
+    case OutboundEvent::kUsageEnd: {
+      const String base = usageCyclePath(ev.date, ev.cycleId);
+      // durationSec and the day-total increment share one update, so a
+      // replay can tell from durationSec whether the increment landed.
+      remote_->batchBeginGroup();
+      remote_->batchSetString(base + "endTime", String(ev.time));
+      remote_->batchSetString(base + "endReason", String(ev.reason));
+      remote_->batchSetString(base + "endInstruction", String(ev.instruction));
+      remote_->batchSetInt(base + "durationSec", (int)ev.durationSec);
+      addUsageToDailyTotal(ev);
+      remote_->batchEndGroup();
+      break;
+    }
+    case OutboundEvent::kUsageTotal:
+      break;  // BLE-only mirror
+    case OutboundEvent::kTempWindow:
+      break;  // uploaded in bulk by uploadTempWindows()
+  }
+}
+
+bool Application::resolveUsageTotal(OutboundEvent &ev) {
+  // A replayed end record may belong to a batch that landed without being
+  // confirmed (timeout, reset before the ack). Its durationSec went out in
+  // the same update as the increment, so finding it means the day total
+  // already holds the cycle. Returns false when that cannot be told yet.
+  if (ev.kind != OutboundEvent::kUsageEnd || !ev.redelivered || ev.totalCounted) return true;
+#if BUILD_ENABLE_RTDB
+  if (remote_ != &rtdb_) return true;  // the BLE total is a RAM accumulator restarted at boot
+  bool landed = false;
+  if (!rtdb_.pathExists(usageCyclePath(ev.date, ev.cycleId) + "durationSec", landed)) return false;
+  ev.totalCounted = landed;
+  if (landed) Logger::info("Usage: cycle %u already in the day total, increment skipped", (unsigned)ev.cycleId);
+#endif
+  return true;
+}
+
+void Application::addUsageToDailyTotal(const OutboundEvent &end) {
+  // Atomic server-side increment of totalDurationSec: one write, no read, and
+  // a failed request never resets the total. Replays that already landed are
+  // flagged by resolveUsageTotal() and not counted again.
+  if (end.totalCounted) return;
+  const String totalPath = usageDayPath(end.date) + "/totalDurationSec";
+  if (remote_ && !remote_->batchIncrementInt(totalPath, (int)end.durationSec)) {
+    Logger::warn("Usage: total increment failed (+%us)", (unsigned)end.durationSec);
+  }
+  // A batch that failed outright is resent in this session; the BLE
+  // accumulator already took the cycle the first time.
+  if (mirrorToBle() && markBleCounted(end.cycleId)) {
+    OutboundEvent ev;
+    ev.kind = OutboundEvent::kUsageTotal;
+    ev.durationSec = end.durationSec;
+    strncpy(ev.date, end.date, sizeof(ev.date) - 1);
+    bleOutQ_.push(ev);
+    notify(bleTask_);
+  }
+}
+
+bool Application::markBleCounted(uint32_t cycleId) {
+  if (cycleId == 0) return true;  // unnamed cycle: nothing to match a resend against
+  for (uint32_t id : bleCountedCycles_) {
+    if (id == cycleId) return false;
+  }
+  bleCountedCycles_[bleCountedNext_] = cycleId;
+  bleCountedNext_ = (uint8_t)((bleCountedNext_ + 1) % kBleCountedCycles);
+  return true;
+}
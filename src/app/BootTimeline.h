@@ -0,0 +1,48 @@
+// BootTimeline.h
+// Time since reset (millis) at which each boot stage completed. Stages are
+// marked once, from whichever task completes them; the first mark wins.
+// Fixed storage, no allocation; safe to read from any task.
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+class BootTimeline {
+ public:
+  enum Stage : uint8_t {
+    kLogger = 0,
+    kRelay,        // relay output off, or restored after a warm restart
+    kSensor,       // DS18B20 bus scanned
+    kJournal,      // usage journal restored
+    kControl,      // control task running: commands and safety are live
+    kBle,          // BLE advertising (local control)
+    kFirstSample,  // first temperature reading handled by control
+    kWifiStart,    // network task started the Wi-Fi connect
+    kCloudInit,    // RTDB client configured (auth runs in the background)
+    kWifiUp,
+    kTimeSync,
+    kCloudUp,      // backend healthy
+    kStageCount
+  };
+
+  // Records nowMs for stage unless it was already marked. Returns true on the first mark.
+  bool mark(Stage s, uint32_t nowMs) {
+    if (s >= kStageCount) return false;
+    uint32_t expected = 0;
+    // 0 means "not reached"; a stage completing at exactly 0 ms is stored as 1.
+    return atMs_[s].compare_exchange_strong(expected, nowMs ? nowMs : 1, std::memory_order_relaxed);
+  }
+
+  bool reached(Stage s) const { return s < kStageCount && atMs_[s].load(std::memory_order_relaxed) != 0; }
+  uint32_t atMs(Stage s) const { return s < kStageCount ? atMs_[s].load(std::memory_order_relaxed) : 0; }
+
+  static const char* name(Stage s) {
+    static const char* const kNames[kStageCount] = {"logger", "relay", "sensor", "journal", "control", "ble",
+                                                    "sample", "wifi-start", "cloud-init", "wifi", "time", "cloud"};
+    return s < kStageCount ? kNames[s] : "?";
+  }
+
+ private:
+  std::atomic<uint32_t> atMs_[kStageCount] = {};
+};
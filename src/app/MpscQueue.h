@@ -0,0 +1,67 @@
+// MpscQueue.h
+// Bounded lock-free multi-producer/single-consumer queue.
+// - Per-cell sequence numbers (Vyukov bounded queue); producers claim slots with CAS
+// - Capacity N must be a power of two; storage is inline (no heap allocation)
+// - push() never blocks; on overflow the item is dropped and counted
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class MpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+ public:
+  MpscQueue() {
+    for (size_t i = 0; i < N; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // Any producer task. Returns false (and counts a drop) when full.
+  bool push(const T &item) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    for (;;) {
+      cell = &cells_[pos & (N - 1)];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;  // full
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = item;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Single consumer task. Returns false when empty.
+  bool pop(T &out) {
+    Cell &cell = cells_[dequeuePos_ & (N - 1)];
+    const size_t seq = cell.seq.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(dequeuePos_ + 1) < 0) return false;
+    out = cell.data;
+    cell.seq.store(dequeuePos_ + N, std::memory_order_release);
+    dequeuePos_++;
+    return true;
+  }
+
+  static constexpr size_t capacity() { return N; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  Cell cells_[N];
+  std::atomic<size_t> enqueuePos_{0};
+  size_t dequeuePos_ = 0;  // consumer-only
+  std::atomic<uint32_t> dropped_{0};
+};
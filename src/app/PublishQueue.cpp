@@ -0,0 +1,101 @@
+// PublishQueue.cpp
+
+#include "PublishQueue.h"
+
+PublishQueue::Class PublishQueue::classOf(const OutboundEvent &ev) {
+  switch (ev.kind) {
+    case OutboundEvent::kRelayState: return kRelay;
+    case OutboundEvent::kUsageStart:
+    case OutboundEvent::kUsageEnd:
+    case OutboundEvent::kUsageTotal: return kUsage;
+    case OutboundEvent::kTempC:
+    case OutboundEvent::kTempWindow: return kTelemetry;
+    case OutboundEvent::kLastUpdate: return kHeartbeat;
+  }
+  return kHeartbeat;
+}
+
+bool PublishQueue::samePath(const OutboundEvent &a, const OutboundEvent &b) {
+  if (a.kind != b.kind) return false;
+  switch (a.kind) {
+    case OutboundEvent::kRelayState:
+    case OutboundEvent::kLastUpdate: return true;
+    case OutboundEvent::kTempC: return a.probe == b.probe;
+    default: return false;  // usage records and windows are distinct writes, never merged
+  }
+}
+
+int PublishQueue::findVictim(Class incoming) const {
+  int victim = -1;
+  for (uint8_t i = 0; i < kCapacity; i++) {
+    if (!entries_[i].used) continue;
+    const Class c = classOf(entries_[i].ev);
+    if (c <= incoming) continue;
+    if (victim < 0) { victim = i; continue; }
+    const Class vc = classOf(entries_[victim].ev);
+    if (c > vc || (c == vc && (int32_t)(entries_[i].seq - entries_[victim].seq) < 0)) victim = i;
+  }
+  return victim;
+}
+
+bool PublishQueue::push(const OutboundEvent &ev) {
+  stats_.enqueued++;
+  int freeSlot = -1;
+  for (uint8_t i = 0; i < kCapacity; i++) {
+    Entry &e = entries_[i];
+    if (!e.used) {
+      if (freeSlot < 0) freeSlot = i;
+      continue;
+    }
+    if (samePath(e.ev, ev)) {
+      // Last value wins; keep the original position in the FIFO.
+      e.ev = ev;
+      stats_.coalesced++;
+      return true;
+    }
+  }
+  if (freeSlot < 0) {
+    freeSlot = findVictim(classOf(ev));
+    stats_.dropped++;
+    if (freeSlot < 0) return false;
+    stats_.depth--;
+  }
+  Entry &e = entries_[freeSlot];
+  e.used = true;
+  e.seq = nextSeq_++;
+  e.ev = ev;
+  stats_.depth++;
+  return true;
+}
+
+uint8_t PublishQueue::drain(uint32_t nowMs, SendFn send, void* ctx, uint8_t maxCount, uint8_t classMask) {
+  // Rate-limit windows are evaluated once per pass so every pending value of
+  // an open class (e.g. all probes) goes out together.
+  bool open[kClassCount];
+  for (uint8_t c = 0; c < kClassCount; c++) {
+    open[c] = (classMask & (1u << c)) && (!everSent_[c] || nowMs - lastSentMs_[c] >= minIntervalMs_[c]);
+  }
+  uint8_t sent = 0;
+  while (sent < maxCount) {
+    int best = -1;
+    for (uint8_t i = 0; i < kCapacity; i++) {
+      if (!entries_[i].used) continue;
+      const Class c = classOf(entries_[i].ev);
+      if (!open[c]) continue;
+      if (best < 0) { best = i; continue; }
+      const Class bc = classOf(entries_[best].ev);
+      if (c < bc || (c == bc && (int32_t)(entries_[i].seq - entries_[best].seq) < 0)) best = i;
+    }
+    if (best < 0) break;
+    Entry &e = entries_[best];
+    const Class c = classOf(e.ev);
+    e.used = false;
+    stats_.depth--;
+    lastSentMs_[c] = nowMs;
+    everSent_[c] = true;
+    send(e.ev, ctx);
+    stats_.sent++;
+    sent++;
+  }
+  return sent;
+}
@@ -0,0 +1,65 @@
+// PublishQueue.h
+// Network-task staging area in front of RemoteBackend for OutboundEvents:
+// - priority classes: relay state > usage records > temperature > heartbeat
+// - last-value-wins coalescing per path (relay state, each probe, LastUpdate)
+// - per-class minimum interval between sends (rate limit)
+// Fixed capacity, no allocation; only the network task touches it.
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "src/app/AppMessages.h"
+#include "src/config/BuildConfig.h"
+
+class PublishQueue {
+ public:
+  enum Class : uint8_t { kRelay = 0, kUsage, kTelemetry, kHeartbeat, kClassCount };
+
+  static constexpr uint8_t kCapacity = BUILD_PUBLISH_QUEUE_DEPTH;
+
+  struct Stats {
+    uint32_t enqueued = 0;
+    uint32_t coalesced = 0;  // replaced a pending value for the same path
+    uint32_t dropped = 0;    // lost to a full queue
+    uint32_t sent = 0;
+    uint8_t depth = 0;
+  };
+
+  using SendFn = void (*)(const OutboundEvent &ev, void* ctx);
+
+  static Class classOf(const OutboundEvent &ev);
+
+  // Minimum time between two sends of the same class (0 = unlimited).
+  void setMinInterval(Class c, uint32_t ms) { if (c < kClassCount) minIntervalMs_[c] = ms; }
+
+  // Stages an event; a pending event for the same path is overwritten. When
+  // full, the oldest lowest-priority entry is evicted if it ranks below ev.
+  // Returns false when ev itself was dropped.
+  bool push(const OutboundEvent &ev);
+
+  // Sends up to maxCount events, highest class first and FIFO within a class,
+  // skipping classes still inside their rate-limit window or missing from
+  // classMask (bit per Class; held events stay queued). Returns the count sent.
+  uint8_t drain(uint32_t nowMs, SendFn send, void* ctx, uint8_t maxCount, uint8_t classMask = 0xFF);
+
+  bool empty() const { return stats_.depth == 0; }
+  const Stats &stats() const { return stats_; }
+
+ private:
+  struct Entry {
+    bool used = false;
+    uint32_t seq = 0;
+    OutboundEvent ev;
+  };
+
+  Entry entries_[kCapacity];
+  uint32_t nextSeq_ = 0;
+  uint32_t minIntervalMs_[kClassCount] = {};
+  uint32_t lastSentMs_[kClassCount] = {};
+  bool everSent_[kClassCount] = {};
+  Stats stats_{};
+
+  static bool samePath(const OutboundEvent &a, const OutboundEvent &b);
+  int findVictim(Class incoming) const;
+};
@@ -0,0 +1,165 @@
+// Scheduler.cpp
+
+#include "Scheduler.h"
+
+int Scheduler::addJob(const char* name, JobFn fn, void* ctx, uint32_t nowMs,
+                      uint32_t periodMs, uint32_t jitterMs, uint8_t priority,
+                      uint32_t firstDelayMs) {
+  if (!fn || periodMs == 0 || jobCount_ >= kMaxJobs) return kInvalidJob;
+  const uint8_t id = jobCount_++;
+  Job &job = jobs_[id];
+  job.name = name;
+  job.fn = fn;
+  job.ctx = ctx;
+  job.periodMs = periodMs;
+  job.jitterMs = jitterMs;
+  job.priority = priority;
+  job.baseMs = nowMs + firstDelayMs;
+  job.deadlineMs = job.baseMs;
+  push(id);
+  return id;
+}
+
+void Scheduler::setPeriod(int id, uint32_t periodMs, uint32_t nowMs) {
+  if (id < 0 || id >= jobCount_ || periodMs == 0) return;
+  Job &job = jobs_[id];
+  if (job.periodMs == periodMs) return;
+  // Rebase on the last run so a shorter period takes effect right away.
+  const uint32_t lastRunMs = job.baseMs - job.periodMs;
+  job.periodMs = periodMs;
+  job.baseMs = lastRunMs + periodMs;
+  if (deadlineBefore(job.baseMs, nowMs)) job.baseMs = nowMs;
+  job.deadlineMs = job.baseMs + jitterSample(job);
+  fixup(heapPos_[id]);
+}
+
+void Scheduler::triggerNow(int id, uint32_t nowMs) {
+  if (id < 0 || id >= jobCount_) return;
+  Job &job = jobs_[id];
+  job.baseMs = nowMs;
+  job.deadlineMs = nowMs;
+  fixup(heapPos_[id]);
+}
+
+void Scheduler::runAfter(int id, uint32_t nowMs, uint32_t delayMs) {
+  if (id < 0 || id >= jobCount_) return;
+  Job &job = jobs_[id];
+  job.baseMs = nowMs + delayMs;
+  job.deadlineMs = job.baseMs;
+  fixup(heapPos_[id]);
+}
+
+uint8_t Scheduler::runDue(uint32_t nowMs) {
+  // Collect everything that is due, then run by priority so a burst of
+  // overdue low-priority work cannot delay a high-priority job.
+  uint8_t due[kMaxJobs];
+  uint8_t dueCount = 0;
+  while (heapSize_ > 0 && !deadlineBefore(nowMs, jobs_[heap_[0]].deadlineMs)) {
+    const uint8_t id = popTop();
+    // Insertion sort by priority (descending); stable for equal priorities.
+    uint8_t i = dueCount++;
+    while (i > 0 && jobs_[due[i - 1]].priority < jobs_[id].priority) {
+      due[i] = due[i - 1];
+      i--;
+    }
+    due[i] = id;
+  }
+  for (uint8_t i = 0; i < dueCount; i++) {
+    Job &job = jobs_[due[i]];
+    const uint32_t runMs = millis();
+    // Advance before running so the job may call setPeriod()/triggerNow() on itself.
+    scheduleNext(job, runMs);
+    job.fn(job.ctx, runMs);
+    push(due[i]);
+  }
+  return dueCount;
+}
+
+uint32_t Scheduler::msUntilNextDue(uint32_t nowMs, uint32_t maxWaitMs) const {
+  if (heapSize_ == 0) return maxWaitMs;
+  const uint32_t next = jobs_[heap_[0]].deadlineMs;
+  if (!deadlineBefore(nowMs, next)) return 0;
+  const uint32_t wait = next - nowMs;
+  return wait < maxWaitMs ? wait : maxWaitMs;
+}
+
+uint32_t Scheduler::periodOf(int id) const {
+  if (id < 0 || id >= jobCount_) return 0;
+  return jobs_[id].periodMs;
+}
+
+void Scheduler::scheduleNext(Job &job, uint32_t nowMs) {
+  job.baseMs += job.periodMs;
+  // Fell more than a period behind (long job or sleep): skip missed runs
+  // instead of firing a catch-up burst.
+  if (deadlineBefore(job.baseMs, nowMs)) job.baseMs = nowMs + job.periodMs;
+  job.deadlineMs = job.baseMs + jitterSample(job);
+}
+
+uint32_t Scheduler::jitterSample(const Job &job) const {
+  if (job.jitterMs == 0) return 0;
+  return (uint32_t)random(0, (long)job.jitterMs + 1);
+}
+
+bool Scheduler::before(uint8_t a, uint8_t b) const {
+  const Job &ja = jobs_[a];
+  const Job &jb = jobs_[b];
+  if (ja.deadlineMs != jb.deadlineMs) return deadlineBefore(ja.deadlineMs, jb.deadlineMs);
+  return ja.priority > jb.priority;
+}
+
+void Scheduler::swapSlots(uint8_t i, uint8_t j) {
+  const uint8_t t = heap_[i];
+  heap_[i] = heap_[j];
+  heap_[j] = t;
+  heapPos_[heap_[i]] = i;
+  heapPos_[heap_[j]] = j;
+}
+
+void Scheduler::siftUp(uint8_t slot) {
+  while (slot > 0) {
+    const uint8_t parent = (slot - 1) / 2;
+    if (!before(heap_[slot], heap_[parent])) break;
+    swapSlots(slot, parent);
+    slot = parent;
+  }
+}
+
+void Scheduler::siftDown(uint8_t slot) {
+  for (;;) {
+    const uint8_t l = 2 * slot + 1;
+    const uint8_t r = l + 1;
+    uint8_t best = slot;
+    if (l < heapSize_ && before(heap_[l], heap_[best])) best = l;
+    if (r < heapSize_ && before(heap_[r], heap_[best])) best = r;
+    if (best == slot) break;
+    swapSlots(slot, best);
+    slot = best;
+  }
+}
+
+void Scheduler::fixup(uint8_t slot) {
+  if (slot >= heapSize_) return;  // job is currently running (popped); re-pushed after
+  const uint8_t job = heap_[slot];
+  siftUp(slot);
+  siftDown(heapPos_[job]);
+}
+
+void Scheduler::push(uint8_t job) {
+  const uint8_t slot = heapSize_++;
+  heap_[slot] = job;
+  heapPos_[job] = slot;
+  siftUp(slot);
+}
+
+uint8_t Scheduler::popTop() {
+  const uint8_t top = heap_[0];
+  heapSize_--;
+  if (heapSize_ > 0) {
+    heap_[0] = heap_[heapSize_];
+    heapPos_[heap_[0]] = 0;
+    siftDown(0);
+  }
+  heapPos_[top] = kMaxJobs;  // marks "not in heap"
+  return top;
+}
@@ -0,0 +1,74 @@
+// Scheduler.h
+// Cooperative deadline scheduler for periodic jobs.
+// - Fixed-capacity min-heap of deadlines (no heap allocation)
+// - Per-job period, random jitter and priority (higher runs first when several are due)
+// - Reports the time until the next deadline so the caller can sleep instead of spinning
+
+#pragma once
+
+#include <Arduino.h>
+
+class Scheduler {
+ public:
+  // C-style job callback (matches RemoteBackend callbacks; avoids std::function bloat)
+  using JobFn = void (*)(void* ctx, uint32_t nowMs);
+
+  static constexpr uint8_t kMaxJobs = 12;
+  static constexpr int kInvalidJob = -1;
+
+  // Registers a periodic job. The first run happens firstDelayMs after nowMs.
+  // Returns a job id, or kInvalidJob when the table is full or arguments are invalid.
+  int addJob(const char* name, JobFn fn, void* ctx, uint32_t nowMs,
+             uint32_t periodMs, uint32_t jitterMs = 0, uint8_t priority = 0,
+             uint32_t firstDelayMs = 0);
+
+  // Changes a job's period; the next deadline is pulled in if the new period is shorter.
+  void setPeriod(int id, uint32_t periodMs, uint32_t nowMs);
+
+  // Makes a job due immediately (e.g. after an external event).
+  void triggerNow(int id, uint32_t nowMs);
+
+  // Overrides only the next deadline (nowMs + delayMs, unjittered); the period
+  // applies again afterwards. Lets a job drive a multi-step state machine.
+  void runAfter(int id, uint32_t nowMs, uint32_t delayMs);
+
+  // Runs every job whose deadline has passed, highest priority first.
+  // Returns the number of jobs executed.
+  uint8_t runDue(uint32_t nowMs);
+
+  // Milliseconds until the earliest deadline (0 if something is already due).
+  // Returns maxWaitMs when no job is registered or the next deadline is further away.
+  uint32_t msUntilNextDue(uint32_t nowMs, uint32_t maxWaitMs) const;
+
+  uint32_t periodOf(int id) const;
+
+ private:
+  struct Job {
+    const char* name = nullptr;
+    JobFn fn = nullptr;
+    void* ctx = nullptr;
+    uint32_t periodMs = 0;
+    uint32_t jitterMs = 0;
+    uint32_t baseMs = 0;      // nominal (unjittered) deadline; keeps cadence drift-free
+    uint32_t deadlineMs = 0;  // baseMs + jitter sample
+    uint8_t priority = 0;
+  };
+
+  Job jobs_[kMaxJobs];
+  uint8_t jobCount_ = 0;
+  // Heap of job indices ordered by deadline; heapPos_ maps job -> heap slot.
+  uint8_t heap_[kMaxJobs];
+  uint8_t heapPos_[kMaxJobs];
+  uint8_t heapSize_ = 0;
+
+  static bool deadlineBefore(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+  bool before(uint8_t a, uint8_t b) const;
+  void swapSlots(uint8_t i, uint8_t j);
+  void siftUp(uint8_t slot);
+  void siftDown(uint8_t slot);
+  void fixup(uint8_t slot);
+  void push(uint8_t job);
+  uint8_t popTop();
+  void scheduleNext(Job &job, uint32_t nowMs);
+  uint32_t jitterSample(const Job &job) const;
+};
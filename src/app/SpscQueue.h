@@ -0,0 +1,52 @@
+// SpscQueue.h
+// Bounded lock-free single-producer/single-consumer ring buffer.
+// - Capacity N must be a power of two; storage is inline (no heap allocation)
+// - push() never blocks; on overflow the item is dropped and counted
+// - Safe across FreeRTOS tasks without a mutex (acquire/release ordering)
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+ public:
+  // Producer side. Returns false (and counts a drop) when full.
+  bool push(const T &item) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= N) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T &out) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    out = slots_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  T slots_[N];
+  std::atomic<size_t> head_{0};  // written by producer
+  std::atomic<size_t> tail_{0};  // written by consumer
+  std::atomic<uint32_t> dropped_{0};
+};
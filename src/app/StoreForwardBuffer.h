@@ -0,0 +1,68 @@
+// StoreForwardBuffer.h
+// Fixed-size ring that holds remote operations while the link is down and
+// hands them back in order once it returns.
+// - Capacity N must be a power of two; storage is inline (no heap allocation)
+// - When full the oldest entry is overwritten and counted as dropped
+// - Single-task use (network task); not thread-safe
+
+#pragma once
+
+#include <Arduino.h>
+
+template <typename T, size_t N>
+class StoreForwardBuffer {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "StoreForwardBuffer capacity must be a power of two");
+
+ public:
+  struct Stats {
+    uint32_t stored = 0;
+    uint32_t replayed = 0;
+    uint32_t dropped = 0;    // oldest entries overwritten while full
+    uint16_t highWater = 0;  // peak occupancy
+  };
+
+  void push(const T &item) {
+    if (head_ - tail_ >= N) {
+      tail_++;  // overwrite the oldest
+      stats_.dropped++;
+    }
+    slots_[head_ & (N - 1)] = item;
+    head_++;
+    stats_.stored++;
+    if (size() > stats_.highWater) stats_.highWater = (uint16_t)size();
+  }
+
+  bool pop(T &out) {
+    if (head_ == tail_) return false;
+    out = slots_[tail_ & (N - 1)];
+    tail_++;
+    stats_.replayed++;
+    return true;
+  }
+
+  // Reads the index-th oldest entry without removing it. With discard(), a
+  // caller consumes entries only once their delivery is confirmed.
+  bool peek(size_t index, T &out) const {
+    if (index >= size()) return false;
+    out = slots_[(tail_ + index) & (N - 1)];
+    return true;
+  }
+
+  // Removes up to n of the oldest entries.
+  void discard(size_t n) {
+    if (n > size()) n = size();
+    tail_ += n;
+    stats_.replayed += (uint32_t)n;
+  }
+
+  size_t size() const { return head_ - tail_; }
+  bool empty() const { return head_ == tail_; }
+  static constexpr size_t capacity() { return N; }
+  const Stats &stats() const { return stats_; }
+
+ private:
+  T slots_[N];
+  size_t head_ = 0;
+  size_t tail_ = 0;
+  Stats stats_{};
+};
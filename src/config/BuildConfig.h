@@ -4,10 +4,285 @@
 #pragma once
 
 #define BUILD_LOG_BAUD_RATE 115200
+#ifndef BUILD_LOG_SERIAL_WAIT_MS
+#define BUILD_LOG_SERIAL_WAIT_MS 0  // max wait for a USB serial host at boot (raise to see early logs)
+#endif
+
+// FreeRTOS tasks: stack sizes in bytes (ESP-IDF convention) and priorities.
+// Control outranks everything so relay decisions never queue behind TLS I/O.
+#ifndef BUILD_TASK_CONTROL_STACK
+#define BUILD_TASK_CONTROL_STACK 4096
+#endif
+#ifndef BUILD_TASK_CONTROL_PRIO
+#define BUILD_TASK_CONTROL_PRIO 4
+#endif
+#ifndef BUILD_TASK_SENSOR_STACK
+#define BUILD_TASK_SENSOR_STACK 3072
+#endif
+#ifndef BUILD_TASK_SENSOR_PRIO
+#define BUILD_TASK_SENSOR_PRIO 3
+#endif
+#ifndef BUILD_TASK_BLE_STACK
+#define BUILD_TASK_BLE_STACK 4096
+#endif
+#ifndef BUILD_TASK_BLE_PRIO
+#define BUILD_TASK_BLE_PRIO 2
+#endif
+#ifndef BUILD_TASK_NETWORK_STACK
+#define BUILD_TASK_NETWORK_STACK 10240   // TLS handshakes need the headroom
+#endif
+#ifndef BUILD_TASK_NETWORK_PRIO
+#define BUILD_TASK_NETWORK_PRIO 1
+#endif
+
+// Inter-task queue depths (powers of two).
+#ifndef BUILD_QUEUE_SENSOR_DEPTH
+#define BUILD_QUEUE_SENSOR_DEPTH 4
+#endif
+#ifndef BUILD_QUEUE_COMMAND_DEPTH
+#define BUILD_QUEUE_COMMAND_DEPTH 8
+#endif
+#ifndef BUILD_QUEUE_SETTINGS_DEPTH
+#define BUILD_QUEUE_SETTINGS_DEPTH 2
+#endif
+#ifndef BUILD_QUEUE_OUTBOUND_DEPTH
+#define BUILD_QUEUE_OUTBOUND_DEPTH 16
+#endif
+
+// Scheduler job periods (ms). Jobs are staggered at boot and jittered so they
+// do not all fire in the same pass.
+#ifndef BUILD_SERVICE_PERIOD_MS
+#define BUILD_SERVICE_PERIOD_MS 20        // Wi-Fi state machine + backend loops
+#endif
+#ifndef BUILD_BLE_SERVICE_PERIOD_MS
+#define BUILD_BLE_SERVICE_PERIOD_MS 50    // BLE backend loop
+#endif
+#ifndef BUILD_SETTINGS_PERIOD_MS
+#define BUILD_SETTINGS_PERIOD_MS 15000    // pull settings from the active backend
+#endif
+#ifndef BUILD_SETTINGS_FULL_REFRESH_MS
+#define BUILD_SETTINGS_FULL_REFRESH_MS 600000  // full fetch even when the revision is unchanged
+#endif
+#ifndef BUILD_TEMP_PERIOD_MS
+#define BUILD_TEMP_PERIOD_MS 15000        // DS18B20 read (telemetry is change-driven, see TelemetryGate)
+#endif
+#ifndef BUILD_SAFETY_PERIOD_MS
+#define BUILD_SAFETY_PERIOD_MS 1000       // fastest read cadence: relay ON and near the cutoff
+#endif
+// Adaptive sampling (SamplingPolicy): BUILD_SAFETY_PERIOD_MS .. BUILD_SAMPLE_IDLE_PERIOD_MS
+#ifndef BUILD_SAMPLE_HEATING_PERIOD_MS
+#define BUILD_SAMPLE_HEATING_PERIOD_MS 5000   // relay ON, still well below the cutoff
+#endif
+#ifndef BUILD_SAMPLE_IDLE_PERIOD_MS
+#define BUILD_SAMPLE_IDLE_PERIOD_MS 60000     // relay OFF and temperature stable
+#endif
+#ifndef BUILD_SAMPLE_NEAR_CUTOFF_C
+#define BUILD_SAMPLE_NEAR_CUTOFF_C 5.0f       // "near" band below max_temp
+#endif
+#ifndef BUILD_SAMPLE_STABLE_DELTA_C
+#define BUILD_SAMPLE_STABLE_DELTA_C 0.25f     // max change between samples counted as stable
+#endif
+#ifndef BUILD_SAMPLE_STABLE_COUNT
+#define BUILD_SAMPLE_STABLE_COUNT 4           // consecutive stable samples before slowing down
+#endif
+// DS18B20 probes on PIN_DS18B20_DATA (role 0 = safety/top of tank).
+#ifndef BUILD_DS18B20_MAX_PROBES
+#define BUILD_DS18B20_MAX_PROBES 3         // top, bottom, inlet
+#endif
+#ifndef BUILD_DS18B20_SAFETY_RESOLUTION
+#define BUILD_DS18B20_SAFETY_RESOLUTION 9  // 94 ms conversions for the fast safety path
+#endif
+#ifndef BUILD_DS18B20_TELEMETRY_RESOLUTION
+#define BUILD_DS18B20_TELEMETRY_RESOLUTION 12
+#endif
+// Probe roles by ROM code, comma-separated in role order (safety first), e.g.
+// "28FF641E0F1603A1,,28AA..."; empty entries are learned on first sight and
+// kept in NVS. Search order alone never decides which probe is the safety one.
+#ifndef BUILD_DS18B20_ROMS
+#define BUILD_DS18B20_ROMS ""
+#endif
+// Bus re-enumeration: a missing probe (none at boot, safety read failing, a
+// bound probe gone) retries from MIN, doubling up to MAX. With free roles and
+// nothing missing, each search that finds nothing new doubles the wait from
+// MAX up to DISCOVER_MAX (late or hot-plugged probes).
+#ifndef BUILD_DS18B20_RESCAN_MIN_MS
+#define BUILD_DS18B20_RESCAN_MIN_MS 2000
+#endif
+#ifndef BUILD_DS18B20_RESCAN_MAX_MS
+#define BUILD_DS18B20_RESCAN_MAX_MS 60000
+#endif
+#ifndef BUILD_DS18B20_DISCOVER_MAX_MS
+#define BUILD_DS18B20_DISCOVER_MAX_MS 3600000
+#endif
 
-// Task stack sizes and priorities will be defined once FreeRTOS tasks are added.
+// While the relay is ON, screen fast safety samples with the DS18B20 TH/TL
+// alarm search and only read the scratchpad when an alarm is flagged or a
+// telemetry sample is due (TH = max_temp - hysteresis, whole degrees).
+#ifndef BUILD_DS18B20_ALARM_SCREEN
+#define BUILD_DS18B20_ALARM_SCREEN 1
+#endif
+// A clear alarm search only skips the readout within this long of the last
+// valid safety-probe reading; failed TH/TL writes are retried after RETRY.
+#ifndef BUILD_DS18B20_ALARM_TRUST_MS
+#define BUILD_DS18B20_ALARM_TRUST_MS 10000
+#endif
+#ifndef BUILD_DS18B20_ALARM_RETRY_MS
+#define BUILD_DS18B20_ALARM_RETRY_MS 30000
+#endif
+// Temperature filter chain (TemperatureFilter)
+#ifndef BUILD_TEMP_MEDIAN_WINDOW
+#define BUILD_TEMP_MEDIAN_WINDOW 3        // median-of-N spike rejection (1 = off)
+#endif
+#ifndef BUILD_TEMP_SMOOTHER
+#define BUILD_TEMP_SMOOTHER 0             // 0 = EMA, 1 = 1-D Kalman
+#endif
+#ifndef BUILD_TEMP_EMA_ALPHA
+#define BUILD_TEMP_EMA_ALPHA 0.3f
+#endif
+#ifndef BUILD_TEMP_KALMAN_Q
+#define BUILD_TEMP_KALMAN_Q 0.02f
+#endif
+#ifndef BUILD_TEMP_KALMAN_R
+#define BUILD_TEMP_KALMAN_R 0.25f
+#endif
+#ifndef BUILD_TEMP_SLOPE_WINDOW
+#define BUILD_TEMP_SLOPE_WINDOW 6         // samples in the rate-of-rise estimate
+#endif
+#ifndef BUILD_TEMP_PREDICT
+#define BUILD_TEMP_PREDICT 1              // control acts on the temperature predicted at the next sample
+#endif
+#ifndef BUILD_TEMP_POLL_MS
+#define BUILD_TEMP_POLL_MS 20             // conversion-ready poll while a DS18B20 conversion runs
+#endif
+// Change-driven temperature telemetry (TelemetryGate)
+#ifndef BUILD_TELEMETRY_DEADBAND_C
+#define BUILD_TELEMETRY_DEADBAND_C 0.5f      // publish when raw or filtered moves more than this
+#endif
+#ifndef BUILD_TELEMETRY_HEARTBEAT_MS
+#define BUILD_TELEMETRY_HEARTBEAT_MS 300000  // ...or at least this often
+#endif
+// Temperature history: per-window summaries uploaded in one batch (WindowAggregator)
+#ifndef BUILD_TEMP_WINDOW_SEC
+#define BUILD_TEMP_WINDOW_SEC 60              // min/max/mean/last per window
+#endif
+#ifndef BUILD_TEMP_UPLOAD_PERIOD_MS
+#define BUILD_TEMP_UPLOAD_PERIOD_MS 600000    // one Records/Temperature write per period
+#endif
+#ifndef BUILD_TEMP_WINDOW_BUFFER
+#define BUILD_TEMP_WINDOW_BUFFER 32           // power of two; oldest windows dropped beyond this
+#endif
+// Compressed on-device history of the windows above (CompressedHistory);
+// 32 x 256 B holds about 7 days of 1-minute points (~6 bits/point).
+#ifndef BUILD_HISTORY_BLOCKS
+#define BUILD_HISTORY_BLOCKS 32
+#endif
+#ifndef BUILD_HISTORY_BLOCK_BYTES
+#define BUILD_HISTORY_BLOCK_BYTES 256
+#endif
+#ifndef BUILD_HISTORY_STREAM_MAX
+#define BUILD_HISTORY_STREAM_MAX 60           // backfilled points per RTDB upload
+#endif
+#ifndef BUILD_BLE_HISTORY_POINTS_PER_PASS
+#define BUILD_BLE_HISTORY_POINTS_PER_PASS 16  // points notified per BLE service pass
+#endif
+// Network-side publish queue (PublishQueue): coalescing + per-class rate limits
+#ifndef BUILD_PUBLISH_QUEUE_DEPTH
+#define BUILD_PUBLISH_QUEUE_DEPTH 24
+#endif
+#ifndef BUILD_PUBLISH_PERIOD_MS
+#define BUILD_PUBLISH_PERIOD_MS 250           // re-check rate-limited classes
+#endif
+#ifndef BUILD_PUBLISH_MAX_PER_FLUSH
+#define BUILD_PUBLISH_MAX_PER_FLUSH 12        // events per write batch
+#endif
+#ifndef BUILD_PUBLISH_TEMP_MIN_MS
+#define BUILD_PUBLISH_TEMP_MIN_MS 5000        // temperature writes at most this often
+#endif
+#ifndef BUILD_PUBLISH_HEARTBEAT_MIN_MS
+#define BUILD_PUBLISH_HEARTBEAT_MIN_MS 10000  // LastUpdate writes at most this often
+#endif
+// Store-and-forward while offline (StoreForwardBuffer)
+#ifndef BUILD_OFFLINE_BUFFER_DEPTH
+#define BUILD_OFFLINE_BUFFER_DEPTH 64         // power of two
+#endif
+#ifndef BUILD_OFFLINE_REPLAY_BATCH
+#define BUILD_OFFLINE_REPLAY_BATCH 8          // buffered events per replay batch
+#endif
+#ifndef BUILD_OFFLINE_REPLAY_PERIOD_MS
+#define BUILD_OFFLINE_REPLAY_PERIOD_MS 1000   // minimum gap between replay batches
+#endif
+// Usage-cycle journal on LittleFS (UsageJournal): records survive reboots until acknowledged
+#ifndef BUILD_ENABLE_USAGE_JOURNAL
+#define BUILD_ENABLE_USAGE_JOURNAL 1
+#endif
+#ifndef BUILD_JOURNAL_MAX_BYTES
+#define BUILD_JOURNAL_MAX_BYTES 16384         // compact when an append would exceed this
+#endif
+#ifndef BUILD_JOURNAL_MAX_PENDING
+#define BUILD_JOURNAL_MAX_PENDING 64          // unacknowledged entries tracked in RAM
+#endif
+#ifndef BUILD_USAGE_RECOVERED_MAX_SEC
+#define BUILD_USAGE_RECOVERED_MAX_SEC 21600   // longer reset gaps close the cycle with 0 s
+#endif
+#ifndef BUILD_JOURNAL_ACK_SLOTS
+#define BUILD_JOURNAL_ACK_SLOTS 4             // write batches awaiting confirmation at once
+#endif
+// Control state snapshot in RTC memory (WarmStateStore): relay, schedules and
+// the open usage cycle resume after a brownout/watchdog/panic reset
+#ifndef BUILD_ENABLE_WARM_RESTART
+#define BUILD_ENABLE_WARM_RESTART 1
+#endif
+#ifndef BUILD_WARM_RESTART_MAX_CHAIN
+#define BUILD_WARM_RESTART_MAX_CHAIN 3        // warm restarts in a row before the relay boots off instead
+#endif
+#ifndef BUILD_WARM_RESTART_STABLE_MS
+#define BUILD_WARM_RESTART_STABLE_MS 60000    // uptime that ends a restart chain
+#endif
+#ifndef BUILD_CONTROL_PERIOD_MS
+#define BUILD_CONTROL_PERIOD_MS 5000      // schedule triggers + safety cutoff
+#endif
+#ifndef BUILD_HEARTBEAT_PERIOD_MS
+#define BUILD_HEARTBEAT_PERIOD_MS 15000   // LastUpdate time/date publish
+#endif
+// Upper bound on a single idle sleep in a task loop. Tasks also wake early
+// when a queue they consume is notified.
+#ifndef BUILD_TASK_MAX_SLEEP_MS
+#define BUILD_TASK_MAX_SLEEP_MS 1000
+#endif
 
 // Compile-time feature toggles (choose one flavor per build)
+// Wi-Fi connect: cached BSSID/channel first, then a scan for the strongest AP.
+#ifndef BUILD_WIFI_FAST_CONNECT
+#define BUILD_WIFI_FAST_CONNECT 1
+#endif
+#ifndef BUILD_WIFI_FAST_TIMEOUT_MS
+#define BUILD_WIFI_FAST_TIMEOUT_MS 2000       // directed connect gives up and scans after this
+#endif
+#ifndef BUILD_WIFI_CONNECT_TIMEOUT_MS
+#define BUILD_WIFI_CONNECT_TIMEOUT_MS 10000   // connect after a scan backs off after this
+#endif
+#ifndef BUILD_WIFI_SCAN_MS_PER_CHAN
+#define BUILD_WIFI_SCAN_MS_PER_CHAN 120
+#endif
+// Static address (empty = DHCP). DNS defaults to the gateway.
+#ifndef BUILD_WIFI_STATIC_IP
+#define BUILD_WIFI_STATIC_IP ""
+#endif
+#ifndef BUILD_WIFI_STATIC_GATEWAY
+#define BUILD_WIFI_STATIC_GATEWAY ""
+#endif
+#ifndef BUILD_WIFI_STATIC_SUBNET
+#define BUILD_WIFI_STATIC_SUBNET "255.255.255.0"
+#endif
+#ifndef BUILD_WIFI_STATIC_DNS
+#define BUILD_WIFI_STATIC_DNS ""
+#endif
+// Reuse the last DHCP lease as a static address on the fast path (skips
+// DHCP; only safe where the router reserves the device's address).
+#ifndef BUILD_WIFI_REUSE_LEASE
+#define BUILD_WIFI_REUSE_LEASE 0
+#endif
+
 // Online flavor: BUILD_ENABLE_RTDB=1, BUILD_ENABLE_BLE=0, USE_MOBIZT_FIREBASE=1
 // Offline flavor: BUILD_ENABLE_RTDB=0, BUILD_ENABLE_BLE=1, USE_MOBIZT_FIREBASE=0
 // Combined flavor (default here): BUILD_ENABLE_RTDB=1, BUILD_ENABLE_BLE=1.
@@ -21,6 +296,59 @@
 #define USE_MOBIZT_FIREBASE BUILD_ENABLE_RTDB
 #endif
 
+// RTDB command path: SSE stream with polling only as a fallback.
+#ifndef BUILD_RTDB_COMMAND_STREAM
+#define BUILD_RTDB_COMMAND_STREAM 1
+#endif
+#ifndef BUILD_RTDB_COMMAND_POLL_MS
+#define BUILD_RTDB_COMMAND_POLL_MS 2000       // fallback GET cadence while the stream is down
+#endif
+#ifndef BUILD_RTDB_STREAM_TIMEOUT_MS
+#define BUILD_RTDB_STREAM_TIMEOUT_MS 70000    // RTDB sends keep-alive every ~30 s
+#endif
+#ifndef BUILD_RTDB_STREAM_RETRY_MS
+#define BUILD_RTDB_STREAM_RETRY_MS 2000       // first resubscribe delay; doubles up to 60 s
+#endif
+// Asynchronous RTDB writes (RtdbRequestQueue)
+#ifndef BUILD_RTDB_REQUEST_SLOTS
+#define BUILD_RTDB_REQUEST_SLOTS 16           // queued + in-flight writes
+#endif
+#ifndef BUILD_RTDB_MAX_IN_FLIGHT
+#define BUILD_RTDB_MAX_IN_FLIGHT 4            // writes queued in the library's client (one connection, sent in order)
+#endif
+#ifndef BUILD_RTDB_REQUEST_TIMEOUT_MS
+#define BUILD_RTDB_REQUEST_TIMEOUT_MS 10000
+#endif
+#ifndef BUILD_RTDB_BATCH_MAX_BYTES
+#define BUILD_RTDB_BATCH_MAX_BYTES 2048       // an open write batch is flushed early past this size
+#endif
+// Circuit breaker over all RTDB requests and the per-pass blocking budget
+#ifndef BUILD_RTDB_BREAKER_FAILURES
+#define BUILD_RTDB_BREAKER_FAILURES 3         // consecutive failures that open the circuit
+#endif
+#ifndef BUILD_RTDB_BREAKER_OPEN_MS
+#define BUILD_RTDB_BREAKER_OPEN_MS 5000       // first probe after this; doubles per failed probe
+#endif
+#ifndef BUILD_RTDB_BREAKER_MAX_OPEN_MS
+#define BUILD_RTDB_BREAKER_MAX_OPEN_MS 60000
+#endif
+#ifndef BUILD_RTDB_SYNC_TIMEOUT_MS
+#define BUILD_RTDB_SYNC_TIMEOUT_MS 4000       // send/read timeout of one synchronous GET/SET
+#endif
+#ifndef BUILD_RTDB_SYNC_DRAIN_MS
+#define BUILD_RTDB_SYNC_DRAIN_MS 1000         // a sync call waits this long for in-flight writes, else defers
+#endif
+#ifndef BUILD_RTDB_PASS_BUDGET_MS
+#define BUILD_RTDB_PASS_BUDGET_MS 8000        // blocking network time allowed per network task pass
+#endif
+#ifndef BUILD_RTDB_DNS_TTL_MS
+#define BUILD_RTDB_DNS_TTL_MS 300000          // cached address of the database host
+#endif
+// Database URL; override to point the client at a local stand-in/emulator.
+#ifndef BUILD_RTDB_DATABASE_URL
+#define BUILD_RTDB_DATABASE_URL SECRETS_FIREBASE_DATABASE_URL
+#endif
+
 // Verbose settings logging (timers and target temperature) every cycle.
 // Disable by default to reduce flash usage; enable (set to 1) when debugging.
 #ifndef BUILD_LOG_SETTINGS_VERBOSE
@@ -17,11 +17,22 @@ struct RtdbPaths {
     return bp + "/" + userId;
   }
 
+  // Key of an absolute path below root(), as used in multi-location updates
+  // submitted at root(); empty when the path lies outside root().
+  String relative(const String &path) const {
+    const String base = root() + "/";
+    return path.startsWith(base) ? path.substring(base.length()) : String();
+  }
+
   // Timers
   String timersRoot() const { return root() + F("/Timers"); }
   String timerKey(const String &hhmm) const { return timersRoot() + F("/") + hhmm; }
 
+  // Settings revision, bumped by the app after any settings/timer write
+  String settingsVersion() const { return root() + F("/settingsVersion"); }
+
   // Geyser
+  String geyserRoot() const { return root() + F("/Geysers/geyser_1"); }
   String geyserState() const { return root() + F("/Geysers/geyser_1/state"); }
   String hysteresisC() const { return root() + F("/Geysers/geyser_1/hysteresis_c"); }
   // Remote control command path (device listens here)
@@ -29,12 +40,16 @@ struct RtdbPaths {
 
   // Sensor
   String sensorTemp() const { return root() + F("/Geysers/geyser_1/sensor_1"); }
+  // Probe role N (0-based) -> sensor_<N+1>; role 0 (safety) is sensorTemp().
+  String sensorTemp(uint8_t probe) const { return root() + F("/Geysers/geyser_1/sensor_") + String((unsigned)probe + 1); }
   String maxTemp() const { return root() + F("/Geysers/geyser_1/max_temp"); }
 
   // Records
   String usageDay(const String &isoDate) const { return root() + F("/Records/GeyserUsage/") + isoDate; }
+  String temperatureDay(const String &isoDate) const { return root() + F("/Records/Temperature/") + isoDate; }
   String lastUpdateTime() const { return root() + F("/Records/LastUpdate/updateTime"); }
   String lastUpdateDate() const { return root() + F("/Records/LastUpdate/updateDate"); }
+  String lastUpdateServerTs() const { return root() + F("/Records/LastUpdate/serverTs"); }
 };
 
 
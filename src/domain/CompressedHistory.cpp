@@ -0,0 +1,233 @@
+// CompressedHistory.cpp
+
+#include "CompressedHistory.h"
+
+#include <math.h>
+
+namespace {
+// Worst case per point: 4+32 (timestamp) + 3+17 (value) + 1 (relay).
+constexpr uint16_t kMaxPointBits = 57;
+
+inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t unzigzag(uint32_t z) { return (int32_t)(z >> 1) ^ -(int32_t)(z & 1); }
+}  // namespace
+
+bool CompressedHistory::append(uint32_t epochSec, float tempC, bool relayOn) {
+  float scaled = roundf(tempC * kScale);
+  if (scaled > INT16_MAX) scaled = INT16_MAX;
+  if (scaled < INT16_MIN) scaled = INT16_MIN;
+  const int16_t q = (int16_t)scaled;
+
+  if (!started_) {
+    started_ = true;
+    openBlock(0, epochSec, q, relayOn);
+    return true;
+  }
+  if (epochSec <= prevSec_) {
+    stats_.rejected++;
+    return false;
+  }
+  const uint32_t head = headSerial_.load(std::memory_order_relaxed);
+  Block &b = blocks_[head % kBlocks];
+  if ((uint32_t)b.bits + kMaxPointBits > kBlockBytes * 8u) {
+    // Head is full: the next block starts with a raw point.
+    const uint32_t tail = tailSerial_.load(std::memory_order_relaxed);
+    if (head + 1 - tail >= kBlocks) {
+      const Block &old = blocks_[tail % kBlocks];
+      stats_.points -= old.count;
+      stats_.bytesUsed -= (old.bits + 7u) / 8u;
+      stats_.blocksEvicted++;
+      tailSerial_.store(tail + 1, std::memory_order_release);  // readers skip it from now on
+    }
+    openBlock(head + 1, epochSec, q, relayOn);
+    headSerial_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  const int32_t delta = (int32_t)(epochSec - prevSec_);
+  const uint32_t dod = zigzag(delta - prevDelta_);
+  const uint32_t dv = zigzag((int32_t)q - prevQ_);
+  const uint16_t bytesBefore = (b.bits + 7u) / 8u;
+  b.version.fetch_add(1, std::memory_order_acq_rel);
+  uint16_t pos = b.bits;
+  if (dod == 0) {
+    putBits(b.data, pos, 0, 1);
+  } else if (dod < (1u << 7)) {
+    putBits(b.data, pos, 0x2, 2);
+    putBits(b.data, pos, dod, 7);
+  } else if (dod < (1u << 9)) {
+    putBits(b.data, pos, 0x6, 3);
+    putBits(b.data, pos, dod, 9);
+  } else if (dod < (1u << 12)) {
+    putBits(b.data, pos, 0xE, 4);
+    putBits(b.data, pos, dod, 12);
+  } else {
+    putBits(b.data, pos, 0xF, 4);
+    putBits(b.data, pos, dod, 32);
+  }
+  if (dv == 0) {
+    putBits(b.data, pos, 0, 1);
+  } else if (dv < (1u << 4)) {
+    putBits(b.data, pos, 0x2, 2);
+    putBits(b.data, pos, dv, 4);
+  } else if (dv < (1u << 8)) {
+    putBits(b.data, pos, 0x6, 3);
+    putBits(b.data, pos, dv, 8);
+  } else {
+    putBits(b.data, pos, 0x7, 3);
+    putBits(b.data, pos, dv, 17);
+  }
+  putBits(b.data, pos, relayOn ? 1 : 0, 1);
+  b.bits = pos;
+  b.count++;
+  b.lastSec = epochSec;
+  b.version.fetch_add(1, std::memory_order_release);
+
+  prevDelta_ = delta;
+  prevSec_ = epochSec;
+  prevQ_ = q;
+  stats_.points++;
+  stats_.appended++;
+  stats_.bytesUsed += (b.bits + 7u) / 8u - bytesBefore;
+  return true;
+}
+
+void CompressedHistory::openBlock(uint32_t serial, uint32_t epochSec, int16_t q, bool relayOn) {
+  Block &b = blocks_[serial % kBlocks];
+  b.version.fetch_add(1, std::memory_order_acq_rel);
+  b.serial = serial;
+  b.firstSec = epochSec;
+  b.lastSec = epochSec;
+  b.count = 1;
+  b.bits = 0;
+  b.firstQ = q;
+  b.firstRelay = relayOn ? 1 : 0;
+  memset(b.data, 0, sizeof(b.data));
+  b.version.fetch_add(1, std::memory_order_release);
+  prevSec_ = epochSec;
+  prevDelta_ = 0;
+  prevQ_ = q;
+  stats_.points++;
+  stats_.appended++;
+}
+
+CompressedHistory::Cursor CompressedHistory::query(uint32_t fromSec, uint32_t toSec) const {
+  Cursor c;
+  c.store_ = this;
+  c.fromSec_ = fromSec;
+  c.toSec_ = toSec;
+  c.nextSec_ = fromSec;
+  c.serial_ = tailSerial_.load(std::memory_order_acquire);
+  c.done_ = fromSec > toSec;
+  return c;
+}
+
+CompressedHistory::Copy CompressedHistory::snapshot(uint32_t serial, Snapshot &out) const {
+  // Sequence-counter read: copy, then accept only if no write overlapped.
+  const Block &b = blocks_[serial % kBlocks];
+  for (uint8_t attempt = 0; attempt < 4; attempt++) {
+    const uint32_t v = b.version.load(std::memory_order_acquire);
+    if (v & 1u) continue;
+    out.serial = b.serial;
+    out.firstSec = b.firstSec;
+    out.lastSec = b.lastSec;
+    out.count = b.count;
+    out.bits = b.bits;
+    out.firstQ = b.firstQ;
+    out.firstRelay = b.firstRelay;
+    memcpy(out.data, b.data, sizeof(out.data));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (b.version.load(std::memory_order_relaxed) != v) continue;
+    return out.serial == serial && out.count ? Copy::kOk : Copy::kGone;
+  }
+  return Copy::kBusy;
+}
+
+bool CompressedHistory::Cursor::loadBlock() {
+  const uint32_t head = store_->headSerial_.load(std::memory_order_acquire);
+  const uint32_t tail = store_->tailSerial_.load(std::memory_order_acquire);
+  if (serial_ < tail) serial_ = tail;  // evicted while we were away
+  while (serial_ <= head) {
+    const Copy r = store_->snapshot(serial_, snap_);
+    if (r == Copy::kBusy) return false;
+    if (r == Copy::kGone || snap_.lastSec < fromSec_) {
+      serial_++;
+      continue;
+    }
+    if (snap_.firstSec > toSec_) break;
+    index_ = 0;
+    bitPos_ = 0;
+    sec_ = snap_.firstSec;
+    delta_ = 0;
+    q_ = snap_.firstQ;
+    relay_ = snap_.firstRelay != 0;
+    loaded_ = true;
+    return true;
+  }
+  done_ = true;
+  return false;
+}
+
+void CompressedHistory::Cursor::decode(Point &out) {
+  if (index_ > 0) {
+    const uint8_t* d = snap_.data;
+    uint32_t dod = 0;
+    if (getBits(d, bitPos_, 1) == 0) dod = 0;
+    else if (getBits(d, bitPos_, 1) == 0) dod = getBits(d, bitPos_, 7);
+    else if (getBits(d, bitPos_, 1) == 0) dod = getBits(d, bitPos_, 9);
+    else if (getBits(d, bitPos_, 1) == 0) dod = getBits(d, bitPos_, 12);
+    else dod = getBits(d, bitPos_, 32);
+    delta_ += unzigzag(dod);
+    sec_ += (uint32_t)delta_;
+    uint32_t dv = 0;
+    if (getBits(d, bitPos_, 1) == 0) dv = 0;
+    else if (getBits(d, bitPos_, 1) == 0) dv = getBits(d, bitPos_, 4);
+    else if (getBits(d, bitPos_, 1) == 0) dv = getBits(d, bitPos_, 8);
+    else dv = getBits(d, bitPos_, 17);
+    q_ += unzigzag(dv);
+    relay_ = getBits(d, bitPos_, 1) != 0;
+  }
+  index_++;
+  out.epochSec = sec_;
+  out.tempC = (float)q_ / kScale;
+  out.relayOn = relay_;
+}
+
+bool CompressedHistory::Cursor::next(Point &out) {
+  while (!done_) {
+    if (!loaded_ && !loadBlock()) return false;
+    if (index_ >= snap_.count || bitPos_ > snap_.bits) {
+      serial_++;
+      loaded_ = false;
+      continue;
+    }
+    Point p;
+    decode(p);
+    if (p.epochSec < fromSec_) continue;
+    if (p.epochSec > toSec_) {
+      done_ = true;
+      return false;
+    }
+    out = p;
+    nextSec_ = p.epochSec + 1;
+    return true;
+  }
+  return false;
+}
+
+void CompressedHistory::putBits(uint8_t* data, uint16_t &bitPos, uint32_t value, uint8_t n) {
+  // MSB first
+  for (int8_t i = (int8_t)n - 1; i >= 0; i--) {
+    if ((value >> i) & 1u) data[bitPos >> 3] |= (uint8_t)(0x80u >> (bitPos & 7u));
+    bitPos++;
+  }
+}
+
+uint32_t CompressedHistory::getBits(const uint8_t* data, uint32_t &bitPos, uint8_t n) {
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    v = (v << 1) | ((data[bitPos >> 3] >> (7u - (bitPos & 7u))) & 1u);
+    bitPos++;
+  }
+  return v;
+}
@@ -0,0 +1,122 @@
+// CompressedHistory.h
+// In-RAM time series of temperature + relay state, compressed per block:
+// - timestamps as delta-of-delta (regular 1-minute points cost 1 bit)
+// - temperature as 1/16 C fixed point, delta-encoded (unchanged costs 1 bit)
+// - relay state as 1 bit
+// Fixed ring of blocks; the oldest block is dropped when the ring is full.
+// One writer task appends; other tasks read through Cursors, which copy a
+// block under a per-block sequence counter (no locks, retry on overlap).
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#include "src/config/BuildConfig.h"
+
+class CompressedHistory {
+ public:
+  struct Point {
+    uint32_t epochSec = 0;
+    float tempC = 0.0f;
+    bool relayOn = false;
+  };
+
+  static constexpr uint8_t kBlocks = BUILD_HISTORY_BLOCKS;
+  static constexpr uint16_t kBlockBytes = BUILD_HISTORY_BLOCK_BYTES;
+  static constexpr float kScale = 16.0f;  // DS18B20 LSB (0.0625 C)
+
+ private:
+  struct Block {
+    std::atomic<uint32_t> version{0};  // odd while the writer modifies the block
+    uint32_t serial = 0;               // ring position of this block's content
+    uint32_t firstSec = 0;
+    uint32_t lastSec = 0;
+    uint16_t count = 0;
+    uint16_t bits = 0;                 // bits used in data
+    int16_t firstQ = 0;
+    uint8_t firstRelay = 0;
+    uint8_t data[kBlockBytes] = {};
+  };
+
+  // Plain copy of a block taken by a reader.
+  struct Snapshot {
+    uint32_t serial, firstSec, lastSec;
+    uint16_t count, bits;
+    int16_t firstQ;
+    uint8_t firstRelay;
+    uint8_t data[kBlockBytes];
+  };
+
+ public:
+  // Forward iterator over [fromSec, toSec]; outlives appends and evictions
+  // (points evicted before they are reached are skipped).
+  class Cursor {
+   public:
+    // False when no point is available right now; done() then tells whether
+    // the range is exhausted or a block was being written (try again later).
+    bool next(Point &out);
+    bool done() const { return done_; }
+    // Oldest second not returned yet and the range end: query(pendingFromSec(),
+    // toSec()) re-reads the rest, e.g. after a failed upload of what was read.
+    uint32_t pendingFromSec() const { return nextSec_; }
+    uint32_t toSec() const { return toSec_; }
+
+   private:
+    friend class CompressedHistory;
+    const CompressedHistory* store_ = nullptr;
+    uint32_t fromSec_ = 0;
+    uint32_t toSec_ = 0;
+    uint32_t nextSec_ = 0;      // after the last point returned
+    uint32_t serial_ = 0;       // block being decoded
+    bool loaded_ = false;
+    bool done_ = true;
+    Snapshot snap_;
+    // Decoder state within snap_
+    uint16_t index_ = 0;
+    uint32_t bitPos_ = 0;
+    uint32_t sec_ = 0;
+    int32_t delta_ = 0;
+    int32_t q_ = 0;
+    bool relay_ = false;
+    bool loadBlock();
+    void decode(Point &out);
+  };
+
+  struct Stats {
+    uint32_t points = 0;          // currently stored
+    uint32_t appended = 0;
+    uint32_t rejected = 0;        // non-increasing timestamps
+    uint32_t blocksEvicted = 0;
+    uint32_t bytesUsed = 0;       // compressed payload bytes in the ring
+  };
+
+  // Appends a point; timestamps must increase. Writer task only.
+  bool append(uint32_t epochSec, float tempC, bool relayOn);
+
+  // Iterator over points with fromSec <= epochSec <= toSec, oldest first.
+  Cursor query(uint32_t fromSec, uint32_t toSec) const;
+
+  // Writer task only (readers use Cursors).
+  const Stats &stats() const { return stats_; }
+
+  static constexpr size_t storageBytes() { return sizeof(Block) * kBlocks; }
+
+ private:
+  Block blocks_[kBlocks];
+  std::atomic<uint32_t> headSerial_{0};  // serial of the block being written
+  std::atomic<uint32_t> tailSerial_{0};  // oldest serial still stored
+  bool started_ = false;
+  // Encoder state for the head block
+  uint32_t prevSec_ = 0;
+  int32_t prevDelta_ = 0;
+  int32_t prevQ_ = 0;
+  Stats stats_{};
+
+  void openBlock(uint32_t serial, uint32_t epochSec, int16_t q, bool relayOn);
+  enum class Copy : uint8_t { kOk, kBusy, kGone };
+  Copy snapshot(uint32_t serial, Snapshot &out) const;
+  static void putBits(uint8_t* data, uint16_t &bitPos, uint32_t value, uint8_t n);
+  static uint32_t getBits(const uint8_t* data, uint32_t &bitPos, uint8_t n);
+};
@@ -8,11 +8,21 @@ static inline bool belowReenableThreshold(float tempC, float maxTempC, float hys
   return tempC < (maxTempC - hysteresisC);
 }
 
+float effectiveTempC(const ControlInputs &in) {
+  if (in.hasPrediction && in.predictedTempC > in.tempC) return in.predictedTempC;
+  return in.tempC;
+}
+
+bool cutoffRequired(const ControlInputs &in) {
+  return effectiveTempC(in) >= in.maxTempC;
+}
+
 ControlDecision evaluate(const ControlInputs &in) {
   ControlDecision d{};
+  const float tempC = effectiveTempC(in);
 
   // 1) Safety cutoff always first
-  if (in.tempC >= in.maxTempC) {
+  if (cutoffRequired(in)) {
     d.relayOn = false;
     return d;
   }
@@ -21,7 +31,7 @@ ControlDecision evaluate(const ControlInputs &in) {
   if (in.hasCommand) {
     if (in.commandOn) {
       // Turn ON only if sufficiently below cutoff (hysteresis)
-      d.relayOn = belowReenableThreshold(in.tempC, in.maxTempC, in.hysteresisC);
+      d.relayOn = belowReenableThreshold(tempC, in.maxTempC, in.hysteresisC);
     } else {
       d.relayOn = false;
     }
@@ -30,7 +40,7 @@ ControlDecision evaluate(const ControlInputs &in) {
 
   // 3) Schedule if no command
   if (in.scheduleActive) {
-    d.relayOn = belowReenableThreshold(in.tempC, in.maxTempC, in.hysteresisC);
+    d.relayOn = belowReenableThreshold(tempC, in.maxTempC, in.hysteresisC);
   } else {
     d.relayOn = false;
   }
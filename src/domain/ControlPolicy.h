@@ -15,6 +15,10 @@ struct ControlInputs {
   float tempC = 0.0f;
   float maxTempC = 60.0f;
   float hysteresisC = 2.0f;  // re-enable only when temp < (maxTempC - hysteresisC)
+  // Optional filtered temperature predicted at the next sample; when present the
+  // policy acts on the higher of tempC and the prediction (cuts before overshoot).
+  bool hasPrediction = false;
+  float predictedTempC = 0.0f;
 
   // Current relay state (for hysteresis decisions)
   bool relayCurrentlyOn = false;
@@ -28,12 +32,18 @@ namespace ControlPolicy {
 
 // Evaluate the desired relay state given inputs.
 // Decision order:
-// 1) Safety: if temp >= maxTempC => OFF
+// 1) Safety: if effective temp >= maxTempC => OFF
 // 2) Command: if present => ON/OFF (subject to safety above)
 // 3) Schedule: if active and temp < (maxTempC - hysteresis) => ON, else OFF
 // 4) Hysteresis prevents ON until temp sufficiently below cutoff
 ControlDecision evaluate(const ControlInputs &in);
 
+// Temperature the decision is based on: tempC, or the prediction when it is higher.
+float effectiveTempC(const ControlInputs &in);
+
+// True when the safety cutoff (step 1 above) applies.
+bool cutoffRequired(const ControlInputs &in);
+
 }
 
 
@@ -0,0 +1,46 @@
+// SafetyMonitor.h
+// Over-temperature cutoff evaluated on every raw sample, independently of the
+// telemetry cadence and of the network. Holds its own copy of the threshold so
+// a slow or unreachable backend can never delay or disable the cutoff, and
+// measures how long each trip took from sample to relay OFF.
+
+#pragma once
+
+#include <stdint.h>
+
+class SafetyMonitor {
+ public:
+  struct Stats {
+    uint32_t checks = 0;         // samples evaluated
+    uint32_t trips = 0;          // cutoffs performed
+    uint32_t lastLatencyMs = 0;  // sample captured -> relay OFF, most recent trip
+    uint32_t maxLatencyMs = 0;   // worst trip latency since boot
+  };
+
+  // Updates the locally held cutoff; ignores non-positive values so a bad
+  // settings read cannot disable the cutoff.
+  void setThreshold(float maxTempC) {
+    if (maxTempC > 0.0f) maxTempC_ = maxTempC;
+  }
+  float threshold() const { return maxTempC_; }
+
+  // Returns true when a reading at tempC requires the relay to be cut.
+  bool check(float tempC) {
+    stats_.checks++;
+    return tempC >= maxTempC_;
+  }
+
+  // Records a trip: sampleMs is when the reading completed, cutMs when the relay went OFF.
+  void recordTrip(uint32_t sampleMs, uint32_t cutMs) {
+    const uint32_t latency = cutMs - sampleMs;
+    stats_.trips++;
+    stats_.lastLatencyMs = latency;
+    if (latency > stats_.maxLatencyMs) stats_.maxLatencyMs = latency;
+  }
+
+  const Stats &stats() const { return stats_; }
+
+ private:
+  float maxTempC_ = 70.0f;  // default safety cutoff until settings arrive
+  Stats stats_{};
+};
@@ -0,0 +1,79 @@
+// SamplingPolicy.h
+// Chooses the DS18B20 sample period from the heating state and the distance to
+// the cutoff: fast while heating close to max_temp, slow while idle and stable.
+// Pure logic with fixed state; the caller hands the period to the sensor task.
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+class SamplingPolicy {
+ public:
+  enum Mode : uint8_t { kNearCutoff, kHeating, kIdle, kIdleStable };
+
+  struct Bounds {
+    uint32_t nearCutoffMs = 1000;  // relay ON within nearBandC of the cutoff (also the minimum)
+    uint32_t heatingMs = 5000;     // relay ON, further away
+    uint32_t idleMs = 15000;       // relay OFF, temperature still moving
+    uint32_t idleStableMs = 60000; // relay OFF, temperature stable (also the maximum)
+    float nearBandC = 5.0f;
+    float stableDeltaC = 0.25f;
+    uint8_t stableCount = 4;
+  };
+
+  void setBounds(const Bounds &b) { bounds_ = b; }
+
+  // Feeds a new (smoothed) reading; tracks how long the temperature has been stable.
+  void observe(float tempC) {
+    if (haveLast_ && fabsf(tempC - lastC_) <= bounds_.stableDeltaC) {
+      if (stableRun_ < 255) stableRun_++;
+    } else {
+      stableRun_ = 0;
+    }
+    lastC_ = tempC;
+    haveLast_ = true;
+  }
+
+  // Recomputes the mode; returns the period to use in ms (clamped to the bounds).
+  uint32_t evaluate(bool relayOn, float maxTempC) {
+    if (relayOn) {
+      // Without a reading yet, assume the worst and sample fast.
+      mode_ = (!haveLast_ || maxTempC - lastC_ <= bounds_.nearBandC) ? kNearCutoff : kHeating;
+    } else {
+      mode_ = (stableRun_ >= bounds_.stableCount) ? kIdleStable : kIdle;
+    }
+    return periodMs();
+  }
+
+  uint32_t periodMs() const {
+    uint32_t ms = bounds_.idleMs;
+    switch (mode_) {
+      case kNearCutoff: ms = bounds_.nearCutoffMs; break;
+      case kHeating: ms = bounds_.heatingMs; break;
+      case kIdle: ms = bounds_.idleMs; break;
+      case kIdleStable: ms = bounds_.idleStableMs; break;
+    }
+    if (ms < bounds_.nearCutoffMs) ms = bounds_.nearCutoffMs;
+    if (ms > bounds_.idleStableMs) ms = bounds_.idleStableMs;
+    return ms;
+  }
+
+  Mode mode() const { return mode_; }
+  static const char* modeName(Mode m) {
+    switch (m) {
+      case kNearCutoff: return "near-cutoff";
+      case kHeating: return "heating";
+      case kIdle: return "idle";
+      case kIdleStable: return "idle-stable";
+    }
+    return "?";
+  }
+
+ private:
+  Bounds bounds_{};
+  Mode mode_ = kIdle;
+  bool haveLast_ = false;
+  float lastC_ = 0.0f;
+  uint8_t stableRun_ = 0;
+};
@@ -0,0 +1,29 @@
+// Settings.h
+// Plain-data snapshot of user settings (safety cutoff, hysteresis and timers).
+// Fixed-size fields so it can be copied through lock-free task queues.
+
+#pragma once
+
+#include <string.h>
+
+struct SettingsSnapshot {
+  float maxTempC = 70.0f;   // default safety cutoff
+  float hysteresisC = 2.0f; // default re-enable buffer
+  char customTime[6] = {};  // "HH:MM" for CUSTOM, empty when unset
+  // Standard timer flags (enable windows starting at HH:MM)
+  bool t0400 = false;
+  bool t0600 = false;
+  bool t0800 = false;
+  bool t1600 = false;
+  bool t1800 = false;
+
+  bool hasCustomTime() const { return strlen(customTime) == 5; }
+  void setCustomTime(const char* hhmm) {
+    if (hhmm && strlen(hhmm) == 5) {
+      memcpy(customTime, hhmm, 5);
+      customTime[5] = '\0';
+    } else {
+      customTime[0] = '\0';
+    }
+  }
+};
@@ -0,0 +1,54 @@
+// TelemetryGate.h
+// Change-driven telemetry: a reading is published only when the raw or the
+// smoothed value has moved more than a deadband since the last publish, or
+// when the heartbeat interval has passed. One gate per published channel.
+// Pure logic with fixed state.
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+class TelemetryGate {
+ public:
+  struct Config {
+    float deadbandC = 0.5f;
+    uint32_t heartbeatMs = 300000;  // publish at least this often (0 = deadband only)
+  };
+
+  struct Stats {
+    uint32_t published = 0;
+    uint32_t suppressed = 0;
+  };
+
+  void configure(const Config &c) { config_ = c; }
+
+  // Returns true (and records the values as sent) when the reading should go
+  // out. Channels without a smoothed value pass the raw reading twice.
+  bool shouldPublish(float rawC, float smoothedC, uint32_t nowMs) {
+    const bool due = !haveSent_ ||
+                     fabsf(rawC - sentRawC_) > config_.deadbandC ||
+                     fabsf(smoothedC - sentSmoothedC_) > config_.deadbandC ||
+                     (config_.heartbeatMs && nowMs - sentMs_ >= config_.heartbeatMs);
+    if (!due) {
+      stats_.suppressed++;
+      return false;
+    }
+    haveSent_ = true;
+    sentRawC_ = rawC;
+    sentSmoothedC_ = smoothedC;
+    sentMs_ = nowMs;
+    stats_.published++;
+    return true;
+  }
+
+  const Stats &stats() const { return stats_; }
+
+ private:
+  Config config_{};
+  Stats stats_{};
+  bool haveSent_ = false;
+  float sentRawC_ = 0.0f;
+  float sentSmoothedC_ = 0.0f;
+  uint32_t sentMs_ = 0;
+};
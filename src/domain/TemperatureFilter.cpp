@@ -0,0 +1,109 @@
+// TemperatureFilter.cpp
+
+#include "TemperatureFilter.h"
+
+void TemperatureFilter::configure(const Config &cfg) {
+  cfg_ = cfg;
+  if (cfg_.medianWindow < 1) cfg_.medianWindow = 1;
+  if (cfg_.medianWindow > kMaxMedianWindow) cfg_.medianWindow = kMaxMedianWindow;
+  if (cfg_.slopeWindow < 2) cfg_.slopeWindow = 2;
+  if (cfg_.slopeWindow > kMaxSlopeWindow) cfg_.slopeWindow = kMaxSlopeWindow;
+  if (cfg_.emaAlpha <= 0.0f || cfg_.emaAlpha > 1.0f) cfg_.emaAlpha = 0.3f;
+  reset();
+}
+
+void TemperatureFilter::reset() {
+  out_ = Output{};
+  medianCount_ = medianHead_ = 0;
+  estimate_ = 0.0f;
+  variance_ = cfg_.kalmanR;
+  seeded_ = false;
+  slopeCount_ = slopeHead_ = 0;
+}
+
+void TemperatureFilter::seed(float filteredC) {
+  reset();
+  estimate_ = filteredC;
+  seeded_ = true;
+  out_.valid = true;
+  out_.rawC = filteredC;
+  out_.filteredC = filteredC;
+}
+
+const TemperatureFilter::Output &TemperatureFilter::update(float rawC, uint32_t nowMs) {
+  const float median = medianOf(rawC);
+  const float filtered = smooth(median);
+  out_.valid = true;
+  out_.rawC = rawC;
+  out_.filteredC = filtered;
+  out_.slopeCPerMin = slopeOf(filtered, nowMs);
+  return out_;
+}
+
+float TemperatureFilter::predict(uint32_t horizonMs) const {
+  if (!out_.valid) return 0.0f;
+  if (horizonMs > cfg_.maxHorizonMs) horizonMs = cfg_.maxHorizonMs;
+  return out_.filteredC + out_.slopeCPerMin * ((float)horizonMs / 60000.0f);
+}
+
+float TemperatureFilter::medianOf(float rawC) {
+  medianBuf_[medianHead_] = rawC;
+  medianHead_ = (uint8_t)((medianHead_ + 1) % cfg_.medianWindow);
+  if (medianCount_ < cfg_.medianWindow) medianCount_++;
+  // Insertion sort of at most kMaxMedianWindow values; no allocation.
+  float sorted[kMaxMedianWindow];
+  for (uint8_t i = 0; i < medianCount_; i++) {
+    float v = medianBuf_[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > v) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = v;
+  }
+  if (medianCount_ % 2) return sorted[medianCount_ / 2];
+  return 0.5f * (sorted[medianCount_ / 2 - 1] + sorted[medianCount_ / 2]);
+}
+
+float TemperatureFilter::smooth(float x) {
+  if (!seeded_) {
+    // First sample seeds the estimate for both smoothers.
+    estimate_ = x;
+    variance_ = cfg_.kalmanR;
+    seeded_ = true;
+    return estimate_;
+  }
+  if (cfg_.smoother == kKalman) {
+    // Random-walk model: predict (variance grows by Q), then correct with gain K.
+    variance_ += cfg_.kalmanQ;
+    const float k = variance_ / (variance_ + cfg_.kalmanR);
+    estimate_ += k * (x - estimate_);
+    variance_ *= (1.0f - k);
+  } else {
+    estimate_ = cfg_.emaAlpha * x + (1.0f - cfg_.emaAlpha) * estimate_;
+  }
+  return estimate_;
+}
+
+float TemperatureFilter::slopeOf(float filteredC, uint32_t nowMs) {
+  slopeC_[slopeHead_] = filteredC;
+  slopeMs_[slopeHead_] = nowMs;
+  slopeHead_ = (uint8_t)((slopeHead_ + 1) % cfg_.slopeWindow);
+  if (slopeCount_ < cfg_.slopeWindow) slopeCount_++;
+  if (slopeCount_ < 2) return 0.0f;
+  // Least-squares slope over the window; times are taken relative to the
+  // newest sample (minutes) so millis() wrap-around does not matter.
+  float sumT = 0, sumC = 0, sumTT = 0, sumTC = 0;
+  for (uint8_t i = 0; i < slopeCount_; i++) {
+    const float t = -(float)(nowMs - slopeMs_[i]) / 60000.0f;
+    const float c = slopeC_[i];
+    sumT += t;
+    sumC += c;
+    sumTT += t * t;
+    sumTC += t * c;
+  }
+  const float n = (float)slopeCount_;
+  const float denom = n * sumTT - sumT * sumT;
+  if (denom <= 1e-9f) return 0.0f;
+  return (n * sumTC - sumT * sumC) / denom;
+}
@@ -0,0 +1,69 @@
+// TemperatureFilter.h
+// Fixed-footprint signal chain for raw DS18B20 readings:
+//   median-of-N spike rejection -> EMA or 1-D Kalman smoothing -> slope (C/min)
+// plus a linear prediction of the temperature a given time ahead, so control
+// can act on where the water will be at the next sample instead of a lagging average.
+
+#pragma once
+
+#include <stdint.h>
+
+class TemperatureFilter {
+ public:
+  static constexpr uint8_t kMaxMedianWindow = 7;
+  static constexpr uint8_t kMaxSlopeWindow = 8;
+
+  enum Smoother : uint8_t { kEma = 0, kKalman = 1 };
+
+  struct Config {
+    uint8_t medianWindow = 3;    // 1 disables spike rejection (odd values recommended)
+    Smoother smoother = kEma;
+    float emaAlpha = 0.3f;       // lower = smoother, slower to react
+    float kalmanQ = 0.02f;       // process noise (C^2 per sample)
+    float kalmanR = 0.25f;       // measurement noise (C^2)
+    uint8_t slopeWindow = 6;     // samples used for the least-squares slope
+    uint32_t maxHorizonMs = 15000;  // predictions never extrapolate further than this
+  };
+
+  struct Output {
+    bool valid = false;
+    float rawC = 0.0f;
+    float filteredC = 0.0f;
+    float slopeCPerMin = 0.0f;
+  };
+
+  void configure(const Config &cfg);
+  void reset();
+  // Restarts the chain from a known filtered value (e.g. carried over a
+  // reset): output() is valid right away and the next reading is smoothed
+  // against it. Median and slope windows start empty.
+  void seed(float filteredC);
+
+  // Feeds one raw reading captured at nowMs; returns the updated output.
+  const Output &update(float rawC, uint32_t nowMs);
+  const Output &output() const { return out_; }
+
+  // Filtered temperature extrapolated horizonMs ahead (clamped to maxHorizonMs).
+  float predict(uint32_t horizonMs) const;
+
+ private:
+  Config cfg_{};
+  Output out_{};
+  // Median stage
+  float medianBuf_[kMaxMedianWindow] = {};
+  uint8_t medianCount_ = 0;
+  uint8_t medianHead_ = 0;
+  // Smoother stage (EMA uses only estimate_)
+  float estimate_ = 0.0f;
+  float variance_ = 1.0f;
+  bool seeded_ = false;
+  // Slope stage: filtered values with their timestamps
+  float slopeC_[kMaxSlopeWindow] = {};
+  uint32_t slopeMs_[kMaxSlopeWindow] = {};
+  uint8_t slopeCount_ = 0;
+  uint8_t slopeHead_ = 0;
+
+  float medianOf(float rawC);
+  float smooth(float x);
+  float slopeOf(float filteredC, uint32_t nowMs);
+};
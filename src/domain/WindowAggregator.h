@@ -0,0 +1,52 @@
+// WindowAggregator.h
+// Folds readings into fixed wall-clock windows (aligned to multiples of the
+// window length) and reports min/max/mean/last when a window closes.
+// Pure logic with fixed state; a window closes on the first reading of the next.
+
+#pragma once
+
+#include <stdint.h>
+
+class WindowAggregator {
+ public:
+  struct Summary {
+    uint32_t startSec = 0;  // epoch seconds at the window start
+    uint16_t count = 0;
+    float minC = 0.0f;
+    float maxC = 0.0f;
+    float meanC = 0.0f;
+    float lastC = 0.0f;
+  };
+
+  void setWindowSec(uint32_t sec) { windowSec_ = sec ? sec : 60; }
+  uint32_t windowSec() const { return windowSec_; }
+
+  // Adds a reading taken at epochSec. Returns true and fills `closed` when the
+  // reading falls in a later window than the one being accumulated.
+  bool add(float value, uint32_t epochSec, Summary &closed) {
+    const uint32_t start = epochSec - epochSec % windowSec_;
+    bool done = false;
+    if (cur_.count && start != cur_.startSec) {
+      closed = cur_;
+      closed.meanC = sum_ / cur_.count;
+      done = true;
+      cur_.count = 0;
+    }
+    if (cur_.count == 0) {
+      cur_.startSec = start;
+      cur_.minC = cur_.maxC = value;
+      sum_ = 0.0f;
+    }
+    if (value < cur_.minC) cur_.minC = value;
+    if (value > cur_.maxC) cur_.maxC = value;
+    if (cur_.count < UINT16_MAX) cur_.count++;
+    sum_ += value;
+    cur_.lastC = value;
+    return done;
+  }
+
+ private:
+  uint32_t windowSec_ = 60;
+  Summary cur_{};
+  float sum_ = 0.0f;
+};
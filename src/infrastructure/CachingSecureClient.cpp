@@ -0,0 +1,71 @@
+// CachingSecureClient.cpp
+
+#include "CachingSecureClient.h"
+
+#include <WiFi.h>
+#include <string.h>
+
+#include "src/infrastructure/Logger.h"
+
+char CachingSecureClient::dnsHost_[64] = {};
+IPAddress CachingSecureClient::dnsIp_;
+uint32_t CachingSecureClient::dnsResolvedMs_ = 0;
+bool CachingSecureClient::dnsValid_ = false;
+
+bool CachingSecureClient::resolve(const char* host, IPAddress &out, bool &fromCache) {
+  const uint32_t nowMs = millis();
+  fromCache = dnsValid_ && strcmp(host, dnsHost_) == 0 && nowMs - dnsResolvedMs_ < BUILD_RTDB_DNS_TTL_MS;
+  if (fromCache) {
+    stats_.dnsHits++;
+    out = dnsIp_;
+    return true;
+  }
+  stats_.dnsLookups++;
+  if (!WiFi.hostByName(host, out)) {
+    Logger::warn("TLS: DNS lookup for %s failed", host);
+    return false;
+  }
+  // Hosts too long for the cache are simply looked up every time.
+  dnsValid_ = strlen(host) < sizeof(dnsHost_);
+  if (dnsValid_) {
+    strcpy(dnsHost_, host);
+    dnsIp_ = out;
+    dnsResolvedMs_ = nowMs;
+  }
+  return true;
+}
+
+int CachingSecureClient::connect(const char* host, uint16_t port) {
+  IPAddress ip;
+  bool fromCache = false;
+  if (!resolve(host, ip, fromCache)) {
+    stats_.connectFailures++;
+    return 0;
+  }
+  const uint32_t startMs = millis();
+  int rc = WiFiClientSecure::connect(ip, port, host, _CA_cert, _cert, _private_key);
+  uint32_t dnsMs = 0;
+  if (!rc && fromCache) {
+    // The host may have moved: look it up again and retry once.
+    dnsValid_ = false;
+    const uint32_t lookupStartMs = millis();
+    const bool resolved = resolve(host, ip, fromCache);
+    dnsMs = millis() - lookupStartMs;
+    if (resolved) rc = WiFiClientSecure::connect(ip, port, host, _CA_cert, _cert, _private_key);
+  }
+  const uint32_t tookMs = millis() - startMs - dnsMs;
+  if (!rc) {
+    stats_.connectFailures++;
+    Logger::warn("TLS: connect to %s failed after %ums (failures=%u)", host, (unsigned)tookMs,
+                 (unsigned)stats_.connectFailures);
+    return 0;
+  }
+  stats_.handshakes++;
+  stats_.lastHandshakeMs = tookMs;
+  stats_.totalHandshakeMs += tookMs;
+  if (tookMs > stats_.maxHandshakeMs) stats_.maxHandshakeMs = tookMs;
+  Logger::info("TLS: connected to %s in %ums (handshakes=%u, reused=%u, dns hits=%u/%u)", host, (unsigned)tookMs,
+               (unsigned)stats_.handshakes, (unsigned)stats_.reused, (unsigned)stats_.dnsHits,
+               (unsigned)(stats_.dnsHits + stats_.dnsLookups));
+  return rc;
+}
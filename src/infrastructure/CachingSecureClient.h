@@ -0,0 +1,53 @@
+// CachingSecureClient.h
+// WiFiClientSecure for the RTDB host that
+// - caches the host's DNS answer for BUILD_RTDB_DNS_TTL_MS (lwIP does not
+//   report record TTLs) and drops it when a connect to the cached address fails
+// - counts full TLS handshakes, their duration, and requests that went out
+//   on a connection that was still open
+// Connections stay open between requests (the library speaks HTTP keep-alive);
+// nothing here closes them. TLS session resumption is not available: the
+// Arduino core keeps its mbedTLS context private, so every connect is a full
+// handshake.
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#include "src/config/BuildConfig.h"
+
+class CachingSecureClient : public WiFiClientSecure {
+ public:
+  struct Stats {
+    uint32_t handshakes = 0;        // successful connects (all full handshakes)
+    uint32_t connectFailures = 0;
+    uint32_t reused = 0;            // requests started on an open connection
+    uint32_t dnsLookups = 0;
+    uint32_t dnsHits = 0;
+    uint32_t lastHandshakeMs = 0;   // TCP + TLS, DNS excluded
+    uint32_t maxHandshakeMs = 0;
+    uint32_t totalHandshakeMs = 0;
+  };
+
+  // Resolves through the DNS cache, then connects by address with host as SNI.
+  int connect(const char* host, uint16_t port) override;
+  using WiFiClientSecure::connect;
+
+  // Call right before a request is handed to the library.
+  void noteRequest() {
+    if (connected()) stats_.reused++;
+  }
+
+  const Stats &stats() const { return stats_; }
+
+ private:
+  Stats stats_{};
+  bool resolve(const char* host, IPAddress &out, bool &fromCache);
+
+  // One cached answer shared by every instance (the request and stream
+  // clients talk to the same host).
+  static char dnsHost_[64];
+  static IPAddress dnsIp_;
+  static uint32_t dnsResolvedMs_;
+  static bool dnsValid_;
+};
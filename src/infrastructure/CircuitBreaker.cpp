@@ -0,0 +1,74 @@
+// CircuitBreaker.cpp
+
+#include "CircuitBreaker.h"
+
+CircuitBreaker::State CircuitBreaker::poll(uint32_t nowMs) {
+  if (state_ == kOpen && nowMs - stats_.lastTripMs >= stats_.openMs) {
+    state_ = kHalfOpen;
+    probeOut_ = false;
+  }
+  return state_;
+}
+
+bool CircuitBreaker::allow(uint32_t nowMs) {
+  switch (poll(nowMs)) {
+    case kClosed:
+      return true;
+    case kHalfOpen:
+      if (!probeOut_) {
+        probeOut_ = true;
+        stats_.probes++;
+        return true;
+      }
+      break;
+    case kOpen:
+      break;
+  }
+  stats_.rejected++;
+  return false;
+}
+
+bool CircuitBreaker::onSuccess() {
+  stats_.consecutiveFailures = 0;
+  if (state_ == kClosed) return false;
+  // Any answer from the service (probe or a call issued before the trip) closes it.
+  state_ = kClosed;
+  probeOut_ = false;
+  stats_.openMs = config_.openMs;
+  return true;
+}
+
+bool CircuitBreaker::onFailure(uint32_t nowMs) {
+  if (stats_.consecutiveFailures < UINT8_MAX) stats_.consecutiveFailures++;
+  switch (state_) {
+    case kClosed:
+      if (stats_.consecutiveFailures < config_.failureThreshold) return false;
+      stats_.openMs = config_.openMs;
+      trip(nowMs);
+      return true;
+    case kHalfOpen:
+      // Failed probe: wait longer before the next one.
+      stats_.openMs = stats_.openMs >= config_.maxOpenMs / 2 ? config_.maxOpenMs : stats_.openMs * 2;
+      trip(nowMs);
+      return true;
+    case kOpen:
+      break;  // late result of a call issued before the trip
+  }
+  return false;
+}
+
+void CircuitBreaker::trip(uint32_t nowMs) {
+  state_ = kOpen;
+  probeOut_ = false;
+  stats_.trips++;
+  stats_.lastTripMs = nowMs;
+}
+
+const char* CircuitBreaker::stateName(State s) {
+  switch (s) {
+    case kClosed: return "closed";
+    case kOpen: return "open";
+    case kHalfOpen: return "half-open";
+  }
+  return "?";
+}
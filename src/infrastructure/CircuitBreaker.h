@@ -0,0 +1,60 @@
+// CircuitBreaker.h
+// Closed/open/half-open breaker for calls to a remote service:
+// - closed: everything goes out; N consecutive failures trip it open
+// - open: everything is refused until the probe interval has passed
+// - half-open: one probe goes out; success closes, failure re-opens with a
+//   doubled interval (capped)
+// Library-agnostic; the caller reports each admitted call's outcome.
+
+#pragma once
+
+#include <stdint.h>
+
+class CircuitBreaker {
+ public:
+  enum State : uint8_t { kClosed = 0, kOpen, kHalfOpen };
+
+  struct Config {
+    uint8_t failureThreshold = 3;  // consecutive failures that trip the breaker
+    uint32_t openMs = 5000;        // first probe interval
+    uint32_t maxOpenMs = 60000;    // probe interval cap after repeated failed probes
+  };
+
+  struct Stats {
+    uint32_t trips = 0;            // closed/half-open -> open
+    uint32_t rejected = 0;         // calls refused while open or with a probe out
+    uint32_t probes = 0;
+    uint32_t lastTripMs = 0;
+    uint32_t openMs = 0;           // current probe interval
+    uint8_t consecutiveFailures = 0;
+  };
+
+  void configure(const Config &c) {
+    config_ = c;
+    if (config_.failureThreshold == 0) config_.failureThreshold = 1;
+    stats_.openMs = config_.openMs;
+  }
+
+  // Moves open -> half-open once the probe interval has passed, without
+  // admitting anything. Returns the current state.
+  State poll(uint32_t nowMs);
+
+  // True when a call may go out now. In half-open the first caller becomes the
+  // probe and everyone else is refused until its outcome is reported.
+  bool allow(uint32_t nowMs);
+
+  // Outcome of an admitted call. Both return true when the state changed.
+  bool onSuccess();
+  bool onFailure(uint32_t nowMs);
+
+  State state() const { return state_; }
+  const Stats &stats() const { return stats_; }
+  static const char* stateName(State s);
+
+ private:
+  Config config_{};
+  Stats stats_{};
+  State state_ = kClosed;
+  bool probeOut_ = false;
+  void trip(uint32_t nowMs);
+};
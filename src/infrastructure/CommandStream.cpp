@@ -0,0 +1,80 @@
+// CommandStream.cpp
+
+#include "CommandStream.h"
+
+#include "src/infrastructure/Logger.h"
+
+void CommandStream::configure(const Config &c, SubscribeFn subscribe, UnsubscribeFn unsubscribe, void* ctx) {
+  config_ = c;
+  if (config_.retryMs == 0) config_.retryMs = 1;
+  if (config_.maxRetryMs < config_.retryMs) config_.maxRetryMs = config_.retryMs;
+  subscribe_ = subscribe;
+  unsubscribe_ = unsubscribe;
+  hookCtx_ = ctx;
+  stats_.retryMs = config_.retryMs;
+}
+
+void CommandStream::healthyEvent(uint32_t nowMs) {
+  if (!subscribed_ || dropped_) return;  // late event from a subscription already given up
+  lastEventMs_ = nowMs;
+  alive_ = true;
+  stats_.events++;
+  stats_.retryMs = config_.retryMs;
+}
+
+void CommandStream::onKeepAlive(uint32_t nowMs) {
+  healthyEvent(nowMs);
+}
+
+void CommandStream::onValue(bool value, uint32_t nowMs) {
+  if (!subscribed_ || dropped_) return;
+  healthyEvent(nowMs);
+  value_ = value;
+  valuePending_ = true;
+}
+
+void CommandStream::onDrop() {
+  if (!subscribed_ || dropped_) return;
+  dropped_ = true;
+  alive_ = false;
+  stats_.drops++;
+}
+
+void CommandStream::tick(uint32_t nowMs, bool ready) {
+  if (subscribed_ && !dropped_ && nowMs - lastEventMs_ > config_.timeoutMs) {
+    Logger::warn("RTDB: command stream silent for %ums; resubscribing", (unsigned)(nowMs - lastEventMs_));
+    dropped_ = true;
+    alive_ = false;
+    stats_.drops++;
+    stats_.timeouts++;
+  }
+  // A dead subscription may still hold its connection: release it first.
+  if (subscribed_ && dropped_) stop();
+  if (subscribed_ || !ready || (int32_t)(nowMs - nextSubscribeMs_) < 0) return;
+  subscribed_ = true;
+  dropped_ = false;
+  alive_ = false;
+  lastEventMs_ = nowMs;
+  stats_.subscribes++;
+  Logger::info("RTDB: command stream subscribe #%u (next retry in %ums)", (unsigned)stats_.subscribes,
+               (unsigned)stats_.retryMs);
+  if (subscribe_) subscribe_(hookCtx_);
+  // Back off subsequent attempts until an event proves the stream healthy.
+  nextSubscribeMs_ = nowMs + stats_.retryMs;
+  stats_.retryMs = stats_.retryMs >= config_.maxRetryMs / 2 ? config_.maxRetryMs : stats_.retryMs * 2u;
+}
+
+void CommandStream::stop() {
+  if (!subscribed_) return;
+  if (unsubscribe_) unsubscribe_(hookCtx_);
+  subscribed_ = false;
+  dropped_ = false;
+  alive_ = false;
+}
+
+bool CommandStream::takeValue(bool &out) {
+  if (!valuePending_) return false;
+  valuePending_ = false;
+  out = value_;
+  return true;
+}
@@ -0,0 +1,74 @@
+// CommandStream.h
+// Library-agnostic lifecycle of the RTDB command stream (SSE):
+// - subscribes once the transport is ready, resubscribes after errors,
+//   cancel/auth_revoked or silence longer than the timeout
+// - backs off resubscribes (doubling, capped) until an event proves the new
+//   stream healthy; cancel/auth_revoked do not count as proof
+// - always stops the previous subscription before starting a new one
+// - hands the latest command value to the client; the first put after each
+//   subscribe carries the whole node, so a reconnect resyncs the value
+// The client supplies the subscribe/unsubscribe hooks that talk to the
+// database library and feeds it the stream's events.
+
+#pragma once
+
+#include <stdint.h>
+
+class CommandStream {
+ public:
+  // Starts the SSE subscription / stops it (and its connection).
+  using SubscribeFn = void (*)(void* ctx);
+  using UnsubscribeFn = void (*)(void* ctx);
+
+  struct Config {
+    uint32_t timeoutMs = 70000;    // silence (no event, not even keep-alive) that kills the stream
+    uint32_t retryMs = 2000;       // first resubscribe delay
+    uint32_t maxRetryMs = 60000;   // resubscribe delay cap
+  };
+
+  struct Stats {
+    uint32_t events = 0;           // healthy events (put/patch/keep-alive)
+    uint32_t subscribes = 0;
+    uint32_t drops = 0;            // error, cancel/auth_revoked or silence
+    uint32_t timeouts = 0;         // drops caused by silence
+    uint32_t retryMs = 0;          // delay before the next resubscribe
+  };
+
+  void configure(const Config &c, SubscribeFn subscribe, UnsubscribeFn unsubscribe, void* ctx);
+
+  // Stream callbacks (may run inside the library's loop).
+  void onKeepAlive(uint32_t nowMs);
+  void onValue(bool value, uint32_t nowMs);
+  // Error, cancel or auth_revoked: the subscription is dead; tick() replaces it.
+  void onDrop();
+
+  // Expires a silent stream and (re)subscribes when due. ready: the transport
+  // can take a subscription now (authenticated, active).
+  void tick(uint32_t nowMs, bool ready);
+  // Stops the subscription (client deactivated); tick() resubscribes later.
+  void stop();
+
+  // Latest value delivered by the stream since the last call.
+  bool takeValue(bool &out);
+
+  // Events arrive: the command path needs no polling.
+  bool alive() const { return alive_; }
+  bool healthy(uint32_t nowMs) const { return alive_ && nowMs - lastEventMs_ <= config_.timeoutMs; }
+  const Stats &stats() const { return stats_; }
+
+ private:
+  Config config_{};
+  SubscribeFn subscribe_ = nullptr;
+  UnsubscribeFn unsubscribe_ = nullptr;
+  void* hookCtx_ = nullptr;
+  bool subscribed_ = false;        // a subscription is (or was) started and not stopped
+  bool dropped_ = false;           // the subscription died; stop it before the next one
+  bool alive_ = false;             // at least one healthy event since the last subscribe
+  uint32_t lastEventMs_ = 0;
+  uint32_t nextSubscribeMs_ = 0;
+  bool valuePending_ = false;
+  bool value_ = false;
+  Stats stats_{};
+
+  void healthyEvent(uint32_t nowMs);
+};
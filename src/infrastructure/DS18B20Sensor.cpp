@@ -2,6 +2,9 @@
 
 #include "DS18B20Sensor.h"
 
+#include <Preferences.h>
+#include <string.h>
+
 #include "src/infrastructure/Logger.h"
 
 DS18B20Sensor::DS18B20Sensor() {}
@@ -12,32 +15,334 @@ bool DS18B20Sensor::begin(uint8_t dataPin) {
 
   oneWire_ = new OneWire(dataPin);
   sensors_ = new DallasTemperature(oneWire_);
-  sensors_->begin();
+  dataPin_ = dataPin;
+  pending_ = false;
+  ready_ = false;
 
-  int deviceCount = sensors_->getDeviceCount();
-  hasDevice_ = deviceCount > 0;
+  // Roles first, then one search matched against them; reads address probes directly.
+  loadBindings();
+  const int deviceCount = enumerate();
+  for (uint8_t r = 0; r < kMaxProbes; r++) {
+    if (!(boundMask_ & (1u << r))) continue;
+    char hex[17];
+    formatRom(addr_[r], hex);
+    Logger::info("DS18B20: role %u = %s%s%s", (unsigned)r, hex, (configuredMask_ & (1u << r)) ? " (configured)" : "",
+                 present(r) ? "" : " MISSING");
+  }
   if (!hasDevice_) {
     Logger::warn("DS18B20: no devices found on pin %u", (unsigned)dataPin);
+    return false;
+  }
+  if (safetyProbeMissing()) Logger::error("DS18B20: safety probe missing on pin %u", (unsigned)dataPin);
+  Logger::info("DS18B20: %u of %d device(s) on pin %u in use (safety res=%u bit, budget=%u ms%s)",
+               (unsigned)probeCount_, deviceCount, (unsigned)dataPin, (unsigned)probeResolution(kSafetyProbe),
+               (unsigned)broadcastBudgetMs(), parasite_ ? ", parasite" : "");
+  return true;
+}
+
+bool DS18B20Sensor::rescan() {
+  if (!sensors_ || pending_) return false;
+  const uint8_t presentBefore = presentMask_;
+  const uint8_t boundBefore = boundMask_;
+  enumerate();
+  if (presentMask_ == presentBefore && boundMask_ == boundBefore) return false;
+  // New devices carry whatever TH/TL they were shipped with.
+  alarmHighC_ = kAlarmUnset;
+  alarmLowC_ = kAlarmUnset;
+  alarmRetryAtMs_ = 0;
+  if (hasDevice_) {
+    Logger::info("DS18B20: rescan on pin %u: roles present 0x%02x (was 0x%02x, bound 0x%02x, budget=%u ms%s)",
+                 (unsigned)dataPin_, (unsigned)presentMask_, (unsigned)presentBefore, (unsigned)boundMask_,
+                 (unsigned)broadcastBudgetMs(), parasite_ ? ", parasite" : "");
   } else {
-    Logger::info("DS18B20: %d device(s) found on pin %u", deviceCount, (unsigned)dataPin);
+    Logger::warn("DS18B20: rescan found no devices on pin %u (roles were 0x%02x)", (unsigned)dataPin_,
+                 (unsigned)presentBefore);
+  }
+  return true;
+}
+
+int DS18B20Sensor::enumerate() {
+  // DallasTemperature::begin() resets the bus and runs a full ROM search.
+  sensors_->begin();
+  // We time conversions ourselves; requestTemperatures() must not block.
+  sensors_->setWaitForConversion(false);
+  presentMask_ = 0;
+  const uint8_t boundBefore = boundMask_;
+  const int deviceCount = sensors_->getDeviceCount();
+  DeviceAddress rom;
+  for (int i = 0; i < deviceCount; i++) {
+    if (!sensors_->getAddress(rom, (uint8_t)i)) continue;
+    const int role = bindRole(rom);
+    if (role < 0) {
+      char hex[17];
+      formatRom(rom, hex);
+      Logger::warn("DS18B20: probe %s has no free role (pin it with BUILD_DS18B20_ROMS)", hex);
+      continue;
+    }
+    presentMask_ |= (uint8_t)(1u << role);
+  }
+  if (boundMask_ != boundBefore) saveBindings();
+  probeCount_ = 0;
+  for (uint8_t r = 0; r < kMaxProbes; r++) {
+    if (!present(r)) continue;
+    probeCount_++;
+    applyResolution(r, r == kSafetyProbe ? BUILD_DS18B20_SAFETY_RESOLUTION : BUILD_DS18B20_TELEMETRY_RESOLUTION);
+  }
+  hasDevice_ = probeCount_ > 0;
+  parasite_ = hasDevice_ && sensors_->isParasitePowerMode();
+  return deviceCount;
+}
+
+int DS18B20Sensor::bindRole(const DeviceAddress rom) {
+  for (uint8_t r = 0; r < kMaxProbes; r++) {
+    if ((boundMask_ & (1u << r)) && memcmp(addr_[r], rom, sizeof(DeviceAddress)) == 0) return r;
+  }
+  // Unknown ROM: lowest free role. The safety role is only free before any
+  // probe was ever bound to it, so a stranger never replaces a missing one.
+  for (uint8_t r = 0; r < kMaxProbes; r++) {
+    if (boundMask_ & (1u << r)) continue;
+    memcpy(addr_[r], rom, sizeof(DeviceAddress));
+    boundMask_ |= (uint8_t)(1u << r);
+    char hex[17];
+    formatRom(rom, hex);
+    Logger::info("DS18B20: bound probe %s to role %u", hex, (unsigned)r);
+    return r;
   }
-  return hasDevice_;
+  return -1;
+}
+
+namespace {
+const char* kPrefsNamespace = "ds18b20";
+const char* kPrefsKey = "roles";
+constexpr uint8_t kBindingsVersion = 1;
+
+struct StoredBindings {
+  uint8_t version;
+  uint8_t mask;
+  uint8_t rom[DS18B20Sensor::kMaxProbes][8];
+};
+}  // namespace
+
+void DS18B20Sensor::loadBindings() {
+  boundMask_ = 0;
+  configuredMask_ = 0;
+  // BUILD_DS18B20_ROMS: comma-separated 16-digit hex ROM codes by role; an
+  // empty entry leaves that role to the stored or learned binding.
+  const char* cfg = BUILD_DS18B20_ROMS;
+  for (uint8_t r = 0; r < kMaxProbes && *cfg; r++) {
+    const char* comma = strchr(cfg, ',');
+    const size_t len = comma ? (size_t)(comma - cfg) : strlen(cfg);
+    char hex[17] = {};
+    if (len == 16) memcpy(hex, cfg, 16);
+    if (len && parseRom(hex, addr_[r])) {
+      boundMask_ |= (uint8_t)(1u << r);
+      configuredMask_ |= (uint8_t)(1u << r);
+    } else if (len) {
+      Logger::warn("DS18B20: BUILD_DS18B20_ROMS entry %u is not a 16-digit ROM code", (unsigned)r);
+    }
+    if (!comma) break;
+    cfg = comma + 1;
+  }
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, true)) return;  // nothing stored yet
+  StoredBindings b;
+  const size_t n = prefs.getBytes(kPrefsKey, &b, sizeof(b));
+  prefs.end();
+  if (n != sizeof(b) || b.version != kBindingsVersion) return;
+  for (uint8_t r = 0; r < kMaxProbes; r++) {
+    if (!(b.mask & (1u << r)) || (configuredMask_ & (1u << r))) continue;
+    bool taken = false;  // a configured role claimed this ROM elsewhere
+    for (uint8_t c = 0; c < kMaxProbes; c++) {
+      if ((configuredMask_ & (1u << c)) && memcmp(addr_[c], b.rom[r], sizeof(DeviceAddress)) == 0) taken = true;
+    }
+    if (taken) continue;
+    memcpy(addr_[r], b.rom[r], sizeof(DeviceAddress));
+    boundMask_ |= (uint8_t)(1u << r);
+  }
+}
+
+void DS18B20Sensor::saveBindings() {
+  StoredBindings b = {};
+  b.version = kBindingsVersion;
+  b.mask = (uint8_t)(boundMask_ & ~configuredMask_);
+  for (uint8_t r = 0; r < kMaxProbes; r++) {
+    if (b.mask & (1u << r)) memcpy(b.rom[r], addr_[r], sizeof(DeviceAddress));
+  }
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) return;
+  const bool ok = prefs.putBytes(kPrefsKey, &b, sizeof(b)) == sizeof(b);
+  prefs.end();
+  if (!ok) Logger::warn("DS18B20: failed to store probe roles");
+}
+
+void DS18B20Sensor::formatRom(const uint8_t* rom, char* out) {
+  static const char kHex[] = "0123456789ABCDEF";
+  for (uint8_t i = 0; i < 8; i++) {
+    out[2 * i] = kHex[rom[i] >> 4];
+    out[2 * i + 1] = kHex[rom[i] & 0x0F];
+  }
+  out[16] = '\0';
+}
+
+bool DS18B20Sensor::parseRom(const char* hex, uint8_t* rom) {
+  for (uint8_t i = 0; i < 16; i++) {
+    const char c = hex[i];
+    uint8_t v;
+    if (c >= '0' && c <= '9') v = (uint8_t)(c - '0');
+    else if (c >= 'a' && c <= 'f') v = (uint8_t)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F') v = (uint8_t)(c - 'A' + 10);
+    else return false;
+    if (i & 1) rom[i / 2] = (uint8_t)(rom[i / 2] | v);
+    else rom[i / 2] = (uint8_t)(v << 4);
+  }
+  return true;
+}
+
+void DS18B20Sensor::applyResolution(uint8_t probe, uint8_t bits) {
+  // The config register has an EEPROM copy; only write when it differs.
+  uint8_t current = sensors_->getResolution(addr_[probe]);
+  if (current != bits && sensors_->setResolution(addr_[probe], bits)) current = bits;
+  resolution_[probe] = current ? current : 12;
 }
 
 bool DS18B20Sensor::readCelsius(float &outTempC) {
-  if (!sensors_) return false;
+  if (!startConversion()) return false;
+  while (!pollReady(millis())) delay(5);
+  return collectCelsius(outTempC);
+}
+
+bool DS18B20Sensor::startConversion() {
+  if (!sensors_ || !hasDevice_) return false;
+  // Broadcast Convert T (skip ROM); returns as soon as the command is on the wire.
   sensors_->requestTemperatures();
-  float t = sensors_->getTempCByIndex(0);
-  if (t == DEVICE_DISCONNECTED_C) {
-    // Device missing or CRC error; report failure gracefully
-    return false;
+  pendingProbe_ = -1;
+  pendingBudgetMs_ = broadcastBudgetMs();
+  startMs_ = millis();
+  pending_ = true;
+  ready_ = false;
+  return true;
+}
+
+bool DS18B20Sensor::startConversion(uint8_t probe) {
+  if (!sensors_ || !present(probe)) return false;
+  sensors_->requestTemperaturesByAddress(addr_[probe]);
+  pendingProbe_ = (int8_t)probe;
+  pendingBudgetMs_ = budgetForResolution(resolution_[probe]);
+  startMs_ = millis();
+  pending_ = true;
+  ready_ = false;
+  return true;
+}
+
+bool DS18B20Sensor::pollReady(uint32_t nowMs) {
+  if (!pending_) return false;
+  if (ready_) return true;
+  const uint32_t elapsed = nowMs - startMs_;
+  // With external power a converting device holds the bus low until done, so
+  // a single read slot tells us; in parasite mode only the time budget is reliable.
+  if (elapsed >= pendingBudgetMs_ || (!parasite_ && sensors_->isConversionComplete())) {
+    ready_ = true;
+    lastLatencyMs_ = elapsed;
   }
-  // Basic sanity: DS18B20 typical range -55..125 C
-  if (t < -55.0f || t > 125.0f) {
-    return false;
+  return ready_;
+}
+
+bool DS18B20Sensor::collect(Readings &out) {
+  out = Readings{};
+  out.count = probeCount_;
+  if (!sensors_ || !pending_) return false;
+  const int8_t only = pendingProbe_;
+  pending_ = false;
+  ready_ = false;
+  for (uint8_t p = 0; p < kMaxProbes; p++) {
+    if (!present(p) || (only >= 0 && p != (uint8_t)only)) continue;
+    const float t = sensors_->getTempC(addr_[p]);
+    if (!validCelsius(t)) continue;
+    out.tempC[p] = t;
+    out.ok[p] = true;
+  }
+  return out.ok[kSafetyProbe];
+}
+
+bool DS18B20Sensor::collectCelsius(float &outTempC) {
+  Readings r;
+  if (!collect(r)) return false;
+  outTempC = r.tempC[kSafetyProbe];
+  return true;
+}
+
+bool DS18B20Sensor::setAlarmThresholds(int8_t highC, int8_t lowC) {
+  if (!sensors_ || !hasDevice_) return false;
+  if (alarmHighC_ == highC && alarmLowC_ == lowC) return true;  // spare the EEPROM
+  // A probe that did not take the write is retried later, not every wake.
+  const uint32_t now = millis();
+  if (alarmRetryAtMs_ != 0 && (int32_t)(now - alarmRetryAtMs_) < 0) return false;
+  alarmHighC_ = kAlarmUnset;
+  alarmLowC_ = kAlarmUnset;
+  for (uint8_t p = 0; p < kMaxProbes; p++) {
+    if (!present(p)) continue;
+    if (!programAlarm(p, highC, lowC)) {
+      alarmRetryAtMs_ = now + BUILD_DS18B20_ALARM_RETRY_MS;
+      if (alarmRetryAtMs_ == 0) alarmRetryAtMs_ = 1;
+      Logger::warn("DS18B20: TH/TL not confirmed on role %u, alarm screening off (retry in %ums)", (unsigned)p,
+                   (unsigned)BUILD_DS18B20_ALARM_RETRY_MS);
+      return false;
+    }
   }
-  outTempC = t;
+  alarmRetryAtMs_ = 0;
+  alarmHighC_ = highC;
+  alarmLowC_ = lowC;
+  Logger::info("DS18B20: alarm thresholds TH=%d TL=%d on %u probe(s)", (int)highC, (int)lowC, (unsigned)probeCount_);
   return true;
 }
 
+bool DS18B20Sensor::programAlarm(uint8_t probe, int8_t highC, int8_t lowC) {
+  // TH and TL share one scratchpad write and one EEPROM copy; the library's
+  // setHighAlarmTemp()/setLowAlarmTemp() would copy to EEPROM once each.
+  // The registers only count once read back through a CRC-checked scratchpad.
+  ScratchPad scratch;
+  if (!sensors_->isConnected(addr_[probe], scratch)) return false;
+  if ((int8_t)scratch[kScratchTh] == highC && (int8_t)scratch[kScratchTl] == lowC) return true;
+  scratch[kScratchTh] = (uint8_t)highC;
+  scratch[kScratchTl] = (uint8_t)lowC;
+  sensors_->writeScratchPad(addr_[probe], scratch);
+  if (!sensors_->isConnected(addr_[probe], scratch)) return false;
+  return (int8_t)scratch[kScratchTh] == highC && (int8_t)scratch[kScratchTl] == lowC;
+}
+
+bool DS18B20Sensor::alarmFlagged() {
+  if (!oneWire_ || !sensors_) return true;
+  // The alarm search reads "no device answered" as "no alarm". Without a
+  // presence pulse the bus is dead, so report a flag and force a readout.
+  if (!oneWire_->reset()) return true;
+  return sensors_->hasAlarm();
+}
+
+uint32_t DS18B20Sensor::broadcastBudgetMs() const {
+  uint32_t budget = 0;
+  for (uint8_t p = 0; p < kMaxProbes; p++) {
+    if (!present(p)) continue;
+    const uint32_t b = budgetForResolution(resolution_[p]);
+    if (b > budget) budget = b;
+  }
+  return budget ? budget : budgetForResolution(12);
+}
+
+uint32_t DS18B20Sensor::budgetForResolution(uint8_t bits) {
+  // Datasheet tCONV maxima: 93.75 / 187.5 / 375 / 750 ms for 9..12 bits.
+  switch (bits) {
+    case 9: return 94;
+    case 10: return 188;
+    case 11: return 375;
+    default: return 750;
+  }
+}
 
+bool DS18B20Sensor::validCelsius(float t) {
+  if (t == DEVICE_DISCONNECTED_C) {
+    // Device missing or CRC error; report failure gracefully
+    return false;
+  }
+  // Basic sanity: DS18B20 typical range -55..125 C
+  return t >= -55.0f && t <= 125.0f;
+}
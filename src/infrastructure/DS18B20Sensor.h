@@ -1,9 +1,20 @@
 // DS18B20Sensor.h
 // DS18B20 temperature sensor driver using OneWire + DallasTemperature.
 // Responsibilities:
-// - Initialize bus and detect sensor presence
+// - Initialize bus, detect probes and cache their ROM addresses (no per-read enumeration)
+// - Bind probe roles to ROM codes (configured or stored in NVS), not to search order
+// - Re-enumerate on request so late, loose or hot-plugged probes are picked up
+// - Per-probe resolution: fast safety probe, high-resolution telemetry probes
 // - Read Celsius temperature with basic validation
 // - Handle "device not found" and CRC errors gracefully
+// - Non-blocking conversions: start, poll-ready, collect (wait-for-conversion off)
+// - Hardware TH/TL alarm thresholds + alarm search for cheap threshold screening
+//
+// Probes are indexed by role. Role 0 is the safety probe (top of tank);
+// further roles (bottom of tank, inlet) are telemetry only. A role keeps its
+// ROM code across rescans and reboots: BUILD_DS18B20_ROMS pins them, otherwise
+// the first probes seen are bound in ROM order and stored. Later unknown
+// probes only fill free telemetry roles, never a bound safety role.
 
 #pragma once
 
@@ -11,26 +22,128 @@
 #include <OneWire.h>
 #include <DallasTemperature.h>
 
+#include "src/config/BuildConfig.h"
+
 class DS18B20Sensor {
  public:
+  static constexpr uint8_t kMaxProbes = BUILD_DS18B20_MAX_PROBES;
+  static constexpr uint8_t kSafetyProbe = 0;
+  static_assert(kMaxProbes <= 8, "probe roles are tracked in 8-bit masks");
+
+  // Result of one conversion, indexed by role; only probes that took part and
+  // passed validation are ok.
+  struct Readings {
+    uint8_t count = 0;  // probes present on the bus
+    float tempC[kMaxProbes] = {};
+    bool ok[kMaxProbes] = {};
+  };
+
   // Construct the sensor driver (no I/O yet). Call begin() before use.
   DS18B20Sensor();
 
-  // Initialize the OneWire bus on the specified dataPin. Returns true on success.
+  // Initialize the OneWire bus on the specified dataPin, cache probe addresses
+  // and apply per-probe resolutions. Returns true when at least one probe exists.
   // If no devices are found, returns false but the instance remains usable; reads will fail until a device is present.
   bool begin(uint8_t dataPin);
 
-  // Attempt to read the temperature in Celsius into outTempC. Returns true on success.
+  // Searches the bus again and matches the ROMs found against the bound roles.
+  // When a probe appeared or disappeared, resolutions are re-applied and the
+  // alarm thresholds are marked unprogrammed. No-op while a conversion is
+  // pending. Returns true when the set of present probes changed.
+  bool rescan();
+
+  // Blocking convenience: convert all probes, wait and collect the safety probe.
+  // Stalls the caller for up to conversionBudgetMs(); prefer the asynchronous API.
   // On failure (no device, CRC error, disconnected), returns false.
   bool readCelsius(float &outTempC);
 
-  // Returns whether at least one device was detected during the last begin() call.
+  // Asynchronous API. Typical use from a periodic job:
+  //   startConversion() -> pollReady(now) until true -> collect(readings)
+  // Starts one broadcast conversion on every probe and returns immediately;
+  // all probes convert in parallel so N probes cost the latency of the slowest.
+  bool startConversion();
+  // Starts a conversion on a single probe (addressed); only it is collected.
+  bool startConversion(uint8_t probe);
+  // True once the conversion is done: the devices report completion (external
+  // power only) or the worst-case budget of the converting probes has elapsed.
+  bool pollReady(uint32_t nowMs);
+  // Reads every probe that converted, addressing each cached ROM directly.
+  // Returns true when the safety probe produced a valid value.
+  bool collect(Readings &out);
+  // Same as collect() but only returns the safety probe's value.
+  bool collectCelsius(float &outTempC);
+  bool conversionPending() const { return pending_; }
+  // Drops a finished conversion without reading the scratchpad (alarm screening).
+  void discardConversion() { pending_ = false; ready_ = false; }
+
+  // Hardware alarm thresholds (whole degrees, the register resolution). Each
+  // device flags an alarm after a conversion with T >= high or T <= low.
+  // Writes TH/TL (and their EEPROM copy) only on probes that do not already
+  // hold them, then reads them back; false (and alarmsProgrammed() stays
+  // false) until every present probe confirmed them.
+  bool setAlarmThresholds(int8_t highC, int8_t lowC);
+  bool alarmsProgrammed() const { return alarmHighC_ != kAlarmUnset; }
+  // Alarm search (ROM command 0xEC) after a completed conversion: true when any
+  // device on the bus flagged an alarm, or no device answered the reset. A
+  // short bus transaction that replaces the scratchpad readout + CRC when
+  // nothing is near the threshold.
+  bool alarmFlagged();
+
+  // Worst-case time of the pending (or a full broadcast) conversion.
+  uint32_t conversionBudgetMs() const { return pending_ ? pendingBudgetMs_ : broadcastBudgetMs(); }
+  // Measured start -> ready time of the most recent conversion.
+  uint32_t lastConversionLatencyMs() const { return lastLatencyMs_; }
+
+  // Returns whether at least one device was detected during the last begin() or rescan() call.
   bool hasDevice() const { return hasDevice_; }
+  uint8_t probeCount() const { return probeCount_; }
+  uint8_t probeResolution(uint8_t probe) const { return present(probe) ? resolution_[probe] : 0; }
+  // Bit i set: role i has a ROM bound / that ROM answered the last search.
+  uint8_t boundMask() const { return boundMask_; }
+  uint8_t presentMask() const { return presentMask_; }
+  bool present(uint8_t probe) const { return probe < kMaxProbes && (presentMask_ & (1u << probe)); }
+  // The safety role is bound to a ROM that is not on the bus: the readings of
+  // other probes must not stand in for it.
+  bool safetyProbeMissing() const {
+    return (boundMask_ & (1u << kSafetyProbe)) && !(presentMask_ & (1u << kSafetyProbe));
+  }
+
+  static uint32_t budgetForResolution(uint8_t bits);
 
  private:
   OneWire *oneWire_ = nullptr;
   DallasTemperature *sensors_ = nullptr;
   bool hasDevice_ = false;
-};
+  bool parasite_ = false;       // parasite power: completion cannot be polled on the bus
+  uint8_t dataPin_ = 0;
+  uint8_t probeCount_ = 0;
+  DeviceAddress addr_[kMaxProbes];  // ROM bound to each role
+  uint8_t boundMask_ = 0;
+  uint8_t presentMask_ = 0;
+  uint8_t configuredMask_ = 0;      // roles pinned by BUILD_DS18B20_ROMS (never stored)
+  uint8_t resolution_[kMaxProbes] = {};
+  bool pending_ = false;
+  bool ready_ = false;
+  int8_t pendingProbe_ = -1;    // -1 = broadcast (all probes)
+  uint32_t pendingBudgetMs_ = 0;
+  uint32_t startMs_ = 0;
+  uint32_t lastLatencyMs_ = 0;
+  static constexpr int16_t kAlarmUnset = -128;
+  int16_t alarmHighC_ = kAlarmUnset;
+  int16_t alarmLowC_ = kAlarmUnset;
+  uint32_t alarmRetryAtMs_ = 0;     // 0 = no failed TH/TL write pending
+  static constexpr uint8_t kScratchTh = 2;  // scratchpad byte offsets
+  static constexpr uint8_t kScratchTl = 3;
 
+  bool programAlarm(uint8_t probe, int8_t highC, int8_t lowC);
 
+  int enumerate();
+  int bindRole(const DeviceAddress rom);
+  void loadBindings();
+  void saveBindings();
+  static void formatRom(const uint8_t* rom, char* out);
+  static bool parseRom(const char* hex, uint8_t* rom);
+  uint32_t broadcastBudgetMs() const;
+  void applyResolution(uint8_t probe, uint8_t bits);
+  static bool validCelsius(float t);
+};
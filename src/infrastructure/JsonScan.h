@@ -0,0 +1,75 @@
+// JsonScan.h
+// Minimal reader for the flat JSON objects RTDB returns for small subtrees
+// (e.g. {"max_temp":70,"hysteresis_c":2,"state":false}). Only top-level
+// scalar members are looked up; nested objects are skipped. No allocation
+// beyond the returned String.
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace JsonScan {
+
+// Locates the raw token of top-level member `key`. For strings the quotes are
+// stripped (escapes are not decoded; settings values never contain them).
+inline bool rawValue(const char* json, const char* key, String &out) {
+  if (!json) return false;
+  const size_t keyLen = strlen(key);
+  int depth = 0;
+  for (const char* p = json; *p; p++) {
+    if (*p == '{' || *p == '[') { depth++; continue; }
+    if (*p == '}' || *p == ']') { depth--; continue; }
+    if (*p != '"') continue;
+    // String token: find its end, then check whether it is a matching key.
+    const char* s = p + 1;
+    const char* e = s;
+    while (*e && *e != '"') { if (*e == '\\' && e[1]) e++; e++; }
+    if (!*e) return false;
+    const char* after = e + 1;
+    while (*after == ' ') after++;
+    const bool isKey = (*after == ':');
+    if (isKey && depth == 1 && (size_t)(e - s) == keyLen && strncmp(s, key, keyLen) == 0) {
+      const char* v = after + 1;
+      while (*v == ' ') v++;
+      if (*v == '"') {
+        const char* ve = v + 1;
+        while (*ve && *ve != '"') { if (*ve == '\\' && ve[1]) ve++; ve++; }
+        out = String(v + 1).substring(0, (unsigned)(ve - v - 1));
+        return true;
+      }
+      if (*v == '{' || *v == '[') return false;  // not a scalar
+      const char* ve = v;
+      while (*ve && *ve != ',' && *ve != '}' && *ve != ' ') ve++;
+      out = String(v).substring(0, (unsigned)(ve - v));
+      return out.length() > 0 && out != "null";
+    }
+    p = e;  // skip over the string (key or value)
+  }
+  return false;
+}
+
+inline bool readFloat(const char* json, const char* key, float &out) {
+  String raw;
+  if (!rawValue(json, key, raw)) return false;
+  char* end = nullptr;
+  const float v = strtof(raw.c_str(), &end);
+  if (end == raw.c_str()) return false;
+  out = v;
+  return true;
+}
+
+inline bool readBool(const char* json, const char* key, bool &out) {
+  String raw;
+  if (!rawValue(json, key, raw)) return false;
+  if (raw == "true") { out = true; return true; }
+  if (raw == "false") { out = false; return true; }
+  return false;
+}
+
+inline bool readString(const char* json, const char* key, String &out) {
+  return rawValue(json, key, out);
+}
+
+}  // namespace JsonScan
@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 #include "src/config/RtdbPaths.h"
+#include "src/domain/CompressedHistory.h"
+#include "src/domain/Settings.h"
 
 // Abstracts the remote connectivity surface (cloud or BLE) for the Application.
 // BLE may ignore RTDB paths; RTDB uses them to compose database URLs.
@@ -18,10 +20,23 @@ class RemoteBackend {
   // Activate/deactivate the backend (subscribe/unsubscribe, start/stop advertising).
   virtual void activate(bool on) = 0;
 
+  // Called at the start of each network task pass; backends that cap the
+  // time one pass may block reset their budget here.
+  virtual void beginPass() {}
+
+  // False when requests are known to fail right now (e.g. server unreachable);
+  // callers skip optional work instead of waiting for timeouts.
+  virtual bool isHealthy() const { return true; }
+
   // Publish telemetry/state
   virtual bool publishTempC(float tempC) = 0;
   virtual bool publishRelayState(bool on) = 0;
   virtual bool publishLastUpdate(const String& hhmmss, const String& yyyymmdd) = 0;
+  // Additional DS18B20 probes (index 0 is the primary sensor published above).
+  // Backends without a slot for extra probes ignore them.
+  virtual bool publishProbeTempC(uint8_t probe, float tempC) {
+    return probe == 0 ? publishTempC(tempC) : false;
+  }
 
   // Command subscription (invoked when a desired relay state is received)
   // C-style callback to avoid libstdc++ bloat from std::function
@@ -34,10 +49,98 @@ class RemoteBackend {
   virtual bool ensureTimerFlag(const String &key, bool defaultEnabled, bool &outEnabled) = 0;
   virtual bool ensureCustomTime(const String &defaultHhmm, String &outHhmm) = 0;
 
+  // Bulk settings pull: fills `out` with the current settings, creating any
+  // missing value from `defaults`. The default implementation issues one
+  // ensure* call per field; backends that can read whole subtrees override it.
+  // Returns false when no field could be read (out keeps the defaults).
+  virtual bool fetchSettings(const SettingsSnapshot &defaults, SettingsSnapshot &out) {
+    out = defaults;
+    bool any = false;
+    float mt = defaults.maxTempC;
+    if (ensureMaxTemp(defaults.maxTempC, mt)) { out.maxTempC = mt; any = true; }
+    float hy = defaults.hysteresisC;
+    if (ensureHysteresis(defaults.hysteresisC, hy)) { out.hysteresisC = hy; any = true; }
+    String custom;
+    if (ensureCustomTime(defaults.hasCustomTime() ? String(defaults.customTime) : String("05:00"), custom)) {
+      out.setCustomTime(custom.c_str());
+      any = true;
+    }
+    any |= ensureTimerFlag("04:00", defaults.t0400, out.t0400);
+    any |= ensureTimerFlag("06:00", defaults.t0600, out.t0600);
+    any |= ensureTimerFlag("08:00", defaults.t0800, out.t0800);
+    any |= ensureTimerFlag("16:00", defaults.t1600, out.t1600);
+    any |= ensureTimerFlag("18:00", defaults.t1800, out.t1800);
+    return any;
+  }
+
+  // Settings revision: a cheap probe that changes whenever any setting does.
+  // When it matches the revision of the last fetchSettings(), the caller can
+  // skip the full fetch. Backends without a revision return false.
+  virtual bool fetchSettingsRevision(uint32_t &outRevision) {
+    (void)outRevision;
+    return false;
+  }
+
   // Generic R/W for simple integer/string paths (e.g., usage totals)
   virtual bool setStringPath(const String &path, const String &value) = 0;
   virtual bool setIntPath(const String &path, int value) = 0;
   virtual bool getIntPath(const String &path, int &outValue) = 0;
+  // Sets outExists when the backend could read the path; false when the read
+  // failed or the backend keeps no readable state.
+  virtual bool pathExists(const String &path, bool &outExists) {
+    (void)path;
+    (void)outExists;
+    return false;
+  }
+  // Adds delta to the integer at path. The default is a read-modify-write that
+  // refuses to write when the read fails; backends with an atomic increment override it.
+  virtual bool incrementIntPath(const String &path, int delta) {
+    int current = 0;
+    if (!getIntPath(path, current)) return false;
+    return setIntPath(path, current + delta);
+  }
+
+  // Write batch: between beginBatch() and commitBatch() writes may be
+  // collected and sent as one multi-location update. Publishes issued while a
+  // batch is open join it as well. The defaults write through immediately.
+  virtual void beginBatch() {}
+  // Writes between these two calls go out in the same update even when the
+  // batch has to be split by size (e.g. a record and a counter it guards).
+  virtual void batchBeginGroup() {}
+  virtual void batchEndGroup() {}
+  virtual bool batchSetString(const String &path, const String &value) { return setStringPath(path, value); }
+  virtual bool batchSetInt(const String &path, int value) { return setIntPath(path, value); }
+  virtual bool batchIncrementInt(const String &path, int delta) { return incrementIntPath(path, delta); }
+  // Numeric (non-integer) value; backends without numeric paths ignore it.
+  virtual bool batchSetFloat(const String &path, float value) { (void)path; (void)value; return false; }
+  // Object of n numeric children at path (path/keys[i] = values[i]). Backends
+  // that can write the object as one member override this.
+  virtual bool batchSetNumbers(const String &path, const char* const* keys, const float* values, uint8_t n) {
+    bool ok = true;
+    for (uint8_t i = 0; i < n; i++) ok &= batchSetFloat(path + "/" + keys[i], values[i]);
+    return ok;
+  }
+  // Streams up to maxPoints history points from the cursor (joins an open
+  // batch where supported). Returns the number sent; backends without a
+  // history channel send nothing.
+  virtual uint16_t streamHistory(CompressedHistory::Cursor &cursor, uint16_t maxPoints) {
+    (void)cursor;
+    (void)maxPoints;
+    return 0;
+  }
+  // Server-side timestamp (ms since epoch) where supported.
+  virtual bool batchSetServerTimestamp(const String &path) { (void)path; return false; }
+  // Sends the batch; returns false if the combined write failed.
+  virtual bool commitBatch() { return true; }
+  // As commitBatch(), and reports once every write of the batch has settled:
+  // ok=true only when the server confirmed all of them. Backends whose writes
+  // complete synchronously report before returning.
+  using WriteDone = void (*)(bool ok, void* ctx);
+  virtual bool commitBatchWithAck(WriteDone done, void* ctx) {
+    const bool ok = commitBatch();
+    if (done) done(ok, ctx);
+    return ok;
+  }
 };
 
 
@@ -1,14 +1,29 @@
 // RtdbClientMobizt.cpp
 
 #include "RtdbClientMobizt.h"
+#include "src/infrastructure/JsonScan.h"
+#include <time.h>
+
+static String jsonQuote(const String &v) {
+  String out;
+  out.reserve(v.length() + 2);
+  out += '"';
+  for (unsigned i = 0; i < v.length(); i++) {
+    const char c = v[i];
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  out += '"';
+  return out;
+}
 
 #if USE_MOBIZT_FIREBASE
 // Enable features used by the library (matches examples)
 #define ENABLE_USER_AUTH
 #define ENABLE_DATABASE
-#include <WiFiClientSecure.h>
 #include <Arduino.h>  // for millis()
-typedef WiFiClientSecure SSL_CLIENT;
+// Keeps connections open, caches DNS and counts handshakes (see CachingSecureClient.h).
+typedef CachingSecureClient SSL_CLIENT;
 #include <FirebaseClient.h>
 using namespace std;
 
@@ -19,6 +34,9 @@ struct FirebaseImpl {
   SSL_CLIENT ssl_client;
   using AsyncClient = AsyncClientClass;
   AsyncClient aClient{ssl_client};
+  // The SSE stream holds its connection open, so it gets its own TLS client.
+  SSL_CLIENT stream_ssl_client;
+  AsyncClient streamClient{stream_ssl_client};
   UserAuth user_auth{SECRETS_FIREBASE_API_KEY, SECRETS_FIREBASE_AUTH_EMAIL, SECRETS_FIREBASE_AUTH_PASS, 3000};
   RealtimeDatabase Database;
   bool configured = false;
@@ -27,7 +45,142 @@ struct FirebaseImpl {
   bool haveRelayValue = false;
   uint32_t lastPollMs = 0;
   uint32_t lastPollOkMs = 0;
+  // Command stream lifecycle owned by RtdbClientMobizt (fed by the stream callback inside app.loop())
+  CommandStream* stream = nullptr;
+  // Async write engine owned by RtdbClientMobizt (completions are reported here)
+  RtdbRequestQueue* requests = nullptr;
+  // Breaker and pass budget owned by RtdbClientMobizt (fed by every request)
+  CircuitBreaker* breaker = nullptr;
+  RtdbClientMobizt::PassStats* pass = nullptr;
 };
+
+// Stream and write results arrive through plain function callbacks; there is
+// a single RTDB client, so the callbacks reach its state through this pointer.
+static FirebaseImpl* s_impl = nullptr;
+
+static void onCommandStream(AsyncResult &aResult) {
+  FirebaseImpl* impl = s_impl;
+  if (!impl) return;
+  const uint32_t nowMs = millis();
+  if (aResult.isError()) {
+    Logger::warn("RTDB: command stream error (code=%d): %s", aResult.error().code(), aResult.error().message().c_str());
+    impl->stream->onDrop();  // loop() resubscribes after the retry delay
+    return;
+  }
+  if (!aResult.available()) return;
+  RealtimeDatabaseResult &stream = aResult.to<RealtimeDatabaseResult>();
+  if (!stream.isStream()) return;
+  const String event = stream.event();
+  if (event == "cancel" || event == "auth_revoked") {
+    Logger::warn("RTDB: command stream %s; resubscribing", event.c_str());
+    impl->stream->onDrop();
+    return;
+  }
+  // put/patch on the command node itself carry the new boolean; keep-alive only refreshes liveness.
+  if ((event == "put" || event == "patch") && stream.dataPath() == "/") {
+    const String raw = stream.to<String>();
+    if (raw == "true" || raw == "false") {
+      impl->stream->onValue(raw == "true", nowMs);
+      return;
+    }
+  }
+  impl->stream->onKeepAlive(nowMs);
+}
+
+// Feeds a request outcome to the breaker. Any HTTP answer below 500 proves the
+// server reachable; transport errors, timeouts (-1) and 5xx count as failures.
+static void reportOutcome(FirebaseImpl* impl, int code, uint32_t nowMs) {
+  CircuitBreaker &b = *impl->breaker;
+  const CircuitBreaker::Stats &st = b.stats();
+  if (code >= 0 && code < 500) {
+    if (b.onSuccess()) Logger::info("RTDB: circuit closed (trips=%u, rejected=%u)", (unsigned)st.trips, (unsigned)st.rejected);
+  } else if (b.onFailure(nowMs)) {
+    Logger::warn("RTDB: circuit open for %ums after code=%d (trips=%u, deferred=%u)", (unsigned)st.openMs, code,
+                 (unsigned)st.trips, (unsigned)impl->pass->deferred);
+  }
+}
+
+// Synchronous calls block the network task: one starts only while the pass
+// budget still has room for a whole sync timeout and the breaker admits it.
+// They share aClient, and its one connection, with the async writes, so
+// they also wait until no write is in flight. The library is given up to
+// BUILD_RTDB_SYNC_DRAIN_MS to finish them, and that time counts against
+// the pass. No new writes are issued meanwhile: only loop() pumps the
+// queue.
+static bool admitSync(FirebaseImpl* impl) {
+  RtdbClientMobizt::PassStats &pass = *impl->pass;
+  if (pass.spentMs + BUILD_RTDB_SYNC_TIMEOUT_MS > BUILD_RTDB_PASS_BUDGET_MS) {
+    pass.deferred++;
+    return false;
+  }
+  if (impl->requests->stats().inFlight) {
+    const uint32_t drainStartMs = millis();
+    while (impl->requests->stats().inFlight && millis() - drainStartMs < BUILD_RTDB_SYNC_DRAIN_MS) impl->app.loop();
+    pass.spentMs += millis() - drainStartMs;
+    if (pass.spentMs > pass.maxSpentMs) pass.maxSpentMs = pass.spentMs;
+    if (impl->requests->stats().inFlight || pass.spentMs + BUILD_RTDB_SYNC_TIMEOUT_MS > BUILD_RTDB_PASS_BUDGET_MS) {
+      pass.deferred++;
+      return false;
+    }
+  }
+  if (!impl->breaker->allow(millis())) return false;
+  impl->ssl_client.noteRequest();
+  return true;
+}
+
+// Charges the call's blocking time to the pass and reports its outcome.
+// Returns true when the call succeeded.
+static bool finishSync(FirebaseImpl* impl, uint32_t startMs) {
+  const uint32_t nowMs = millis();
+  const int code = impl->aClient.lastError().code();
+  RtdbClientMobizt::PassStats &pass = *impl->pass;
+  pass.spentMs += nowMs - startMs;
+  if (pass.spentMs > pass.maxSpentMs) pass.maxSpentMs = pass.spentMs;
+  reportOutcome(impl, code, nowMs);
+  return code == 0;
+}
+
+static void onWriteResult(AsyncResult &aResult) {
+  FirebaseImpl* impl = s_impl;
+  if (!impl || !impl->requests) return;
+  if (aResult.isError()) {
+    Logger::warn("RTDB: write %s failed (code=%d): %s", aResult.uid().c_str(), aResult.error().code(),
+                 aResult.error().message().c_str());
+    reportOutcome(impl, aResult.error().code(), millis());
+    impl->requests->complete(aResult.uid().c_str(), false, aResult.error().code(), millis());
+  } else if (aResult.available()) {
+    reportOutcome(impl, 0, millis());
+    impl->requests->complete(aResult.uid().c_str(), true, 0, millis());
+  }
+}
+
+static bool issueWrite(const RtdbRequestQueue::Request &req, const char* uid, void* ctx) {
+  auto *impl = static_cast<FirebaseImpl*>(ctx);
+  impl->ssl_client.noteRequest();
+  if (req.method == RtdbRequestQueue::kUpdate) {
+    impl->Database.update<object_t>(impl->aClient, req.path, object_t(req.body), onWriteResult, uid);
+  } else {
+    impl->Database.set<object_t>(impl->aClient, req.path, object_t(req.body), onWriteResult, uid);
+  }
+  return true;
+}
+
+static void cancelWrite(const char* uid, void* ctx) {
+  auto *impl = static_cast<FirebaseImpl*>(ctx);
+  Logger::warn("RTDB: write %s timed out", uid);
+  impl->aClient.stopAsync(String(uid));
+  reportOutcome(impl, -1, millis());
+}
+
+static void subscribeCommandStream(void* ctx) {
+  auto *impl = static_cast<FirebaseImpl*>(ctx);
+  impl->streamClient.setSSEFilters("put,patch,keep-alive,cancel,auth_revoked");
+  impl->Database.get(impl->streamClient, impl->relayPath, onCommandStream, true /* SSE */, "cmdStream");
+}
+
+static void unsubscribeCommandStream(void* ctx) {
+  static_cast<FirebaseImpl*>(ctx)->streamClient.stopAsync();
+}
 #endif
 
 void RtdbClientMobizt::begin(const RtdbPaths* paths) {
@@ -38,6 +191,17 @@ void RtdbClientMobizt::begin(const RtdbPaths* paths) {
   if (!impl_) impl_ = new FirebaseImpl();
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
 
+  CircuitBreaker::Config breakerCfg;
+  breakerCfg.failureThreshold = BUILD_RTDB_BREAKER_FAILURES;
+  breakerCfg.openMs = BUILD_RTDB_BREAKER_OPEN_MS;
+  breakerCfg.maxOpenMs = BUILD_RTDB_BREAKER_MAX_OPEN_MS;
+  breaker_.configure(breakerCfg);
+  impl->breaker = &breaker_;
+  impl->pass = &pass_;
+  // Bound each synchronous call so the pass budget can account for it.
+  impl->aClient.setSyncSendTimeout((BUILD_RTDB_SYNC_TIMEOUT_MS + 999) / 1000);
+  impl->aClient.setSyncReadTimeout((BUILD_RTDB_SYNC_TIMEOUT_MS + 999) / 1000);
+
   // Set SSL client config (use insecure defaults and buffers as needed)
   // Note: ExampleFunctions.h provides helpers; we proceed without it for now.
   impl->ssl_client.setInsecure();
@@ -49,11 +213,22 @@ void RtdbClientMobizt::begin(const RtdbPaths* paths) {
 
   // Bind Realtime Database and set URL
   impl->app.getApp<RealtimeDatabase>(impl->Database);
-  impl->Database.url(SECRETS_FIREBASE_DATABASE_URL);
+  impl->Database.url(BUILD_RTDB_DATABASE_URL);
 
   // Listen to command path only; device will mirror physical state separately
   impl->relayPath = paths_->geyserCommand();
   impl->configured = true;
+  s_impl = impl;
+  impl->requests = &requests_;
+  requests_.configure(BUILD_RTDB_MAX_IN_FLIGHT, BUILD_RTDB_REQUEST_TIMEOUT_MS, &issueWrite, &cancelWrite, impl);
+#if BUILD_RTDB_COMMAND_STREAM
+  impl->stream_ssl_client.setInsecure();
+  CommandStream::Config streamCfg;
+  streamCfg.timeoutMs = BUILD_RTDB_STREAM_TIMEOUT_MS;
+  streamCfg.retryMs = BUILD_RTDB_STREAM_RETRY_MS;
+  commandStream_.configure(streamCfg, &subscribeCommandStream, &unsubscribeCommandStream, impl);
+#endif
+  impl->stream = &commandStream_;
   
   // Settings will be pulled periodically; no settings streams
 #else
@@ -66,29 +241,63 @@ void RtdbClientMobizt::loop() {
   if (!active_) return;
 #endif
 #if USE_MOBIZT_FIREBASE
-  // Maintain authentication and async tasks as per examples
+  // Maintain authentication and async tasks (including the command stream)
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
-  if (impl) impl->app.loop();
+  if (!impl) return;
+  // app.loop() runs the async tasks and may block on a TLS connect; it is
+  // charged to the pass and skipped (deferred) once the budget is spent.
+  if (pass_.spentMs >= BUILD_RTDB_PASS_BUDGET_MS) {
+    pass_.deferred++;
+    return;
+  }
+  const uint32_t loopStartMs = millis();
+  impl->app.loop();
   const uint32_t nowMs = millis();
-  // Poll command path every 2s
-  if (impl && impl->configured) {
-    const uint32_t interval = 2000u;
-    if (nowMs - impl->lastPollMs >= interval) {
-      impl->lastPollMs = nowMs;
-      bool cmd = impl->Database.get<bool>(impl->aClient, impl->relayPath.c_str());
-      if (impl->aClient.lastError().code() == 0) {
-        impl->lastPollOkMs = nowMs;
-        if (!impl->haveRelayValue || cmd != impl->lastRelayKnown) {
-          impl->haveRelayValue = true;
-          impl->lastRelayKnown = cmd;
-          if (relayCallback_) relayCallback_(cmd, relayCtx_);
-        }
+  pass_.spentMs += nowMs - loopStartMs;
+  if (pass_.spentMs > pass_.maxSpentMs) pass_.maxSpentMs = pass_.spentMs;
+  if (!impl->configured) return;
+  pollCommand(nowMs);
+  // Expire and issue queued writes; results arrive via onWriteResult in
+  // app.loop(). After the command GET, which needs none in flight.
+  requests_.pump(nowMs, writeCapacity(nowMs));
+#endif
+}
+
+void RtdbClientMobizt::pollCommand(uint32_t nowMs) {
+#if USE_MOBIZT_FIREBASE
+  auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
+#if BUILD_RTDB_COMMAND_STREAM
+  // The stream delivers commands as they are written; it is considered dead
+  // after an error/cancel or when even keep-alives stop arriving.
+  commandStream_.tick(nowMs, impl->app.ready());
+  bool streamValue = false;
+  if (commandStream_.takeValue(streamValue)) {
+    impl->lastPollOkMs = nowMs;
+    if (!impl->haveRelayValue || streamValue != impl->lastRelayKnown) {
+      impl->haveRelayValue = true;
+      impl->lastRelayKnown = streamValue;
+      if (relayCallback_) relayCallback_(streamValue, relayCtx_);
+    }
+  }
+  if (commandStream_.alive()) return;  // no polling while the stream is up
+#endif
+  // Fallback: poll the command path while the stream is down (or disabled)
+  if (nowMs - impl->lastPollMs >= BUILD_RTDB_COMMAND_POLL_MS) {
+    impl->lastPollMs = nowMs;
+    if (!admitSync(impl)) return;
+    const uint32_t startMs = millis();
+    bool cmd = impl->Database.get<bool>(impl->aClient, impl->relayPath.c_str());
+    if (finishSync(impl, startMs)) {
+      impl->lastPollOkMs = nowMs;
+      if (!impl->haveRelayValue || cmd != impl->lastRelayKnown) {
+        impl->haveRelayValue = true;
+        impl->lastRelayKnown = cmd;
+        if (relayCallback_) relayCallback_(cmd, relayCtx_);
       }
     }
   }
-  
-
-  
+#else
+  (void)nowMs;
 #endif
 }
 
@@ -97,22 +306,32 @@ bool RtdbClientMobizt::publishTempC(float tempC) {
   if (!active_) return false;
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  bool ok = impl->Database.set<float>(impl->aClient, paths_->sensorTemp().c_str(), tempC);
-  if (!ok) Logger::warn("RTDB: set temp failed");
-  return ok;
+  if (batchOpen_) return batchAdd(paths_->sensorTemp(), String(tempC, 2));
+  return submitWrite(RtdbRequestQueue::kSet, paths_->sensorTemp(), String(tempC, 2));
 #else
   (void)tempC; return false;
 #endif
 }
 
+bool RtdbClientMobizt::publishProbeTempC(uint8_t probe, float tempC) {
+#if USE_MOBIZT_FIREBASE
+  if (!active_) return false;
+  auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
+  if (!impl || !impl->configured) return false;
+  if (batchOpen_) return batchAdd(paths_->sensorTemp(probe), String(tempC, 2));
+  return submitWrite(RtdbRequestQueue::kSet, paths_->sensorTemp(probe), String(tempC, 2));
+#else
+  (void)probe; (void)tempC; return false;
+#endif
+}
+
 bool RtdbClientMobizt::publishRelayState(bool on) {
 #if USE_MOBIZT_FIREBASE
   if (!active_) return false;
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  bool ok = impl->Database.set<bool>(impl->aClient, paths_->geyserState().c_str(), on);
-  if (!ok) Logger::warn("RTDB: set relay failed");
-  return ok;
+  if (batchOpen_) return batchAdd(paths_->geyserState(), on ? "true" : "false");
+  return submitWrite(RtdbRequestQueue::kSet, paths_->geyserState(), on ? "true" : "false");
 #else
   (void)on; return false;
 #endif
@@ -123,9 +342,13 @@ bool RtdbClientMobizt::publishLastUpdate(const String& hhmmss, const String& yyy
   if (!active_) return false;
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  bool ok1 = impl->Database.set<String>(impl->aClient, paths_->lastUpdateTime().c_str(), hhmmss);
-  bool ok2 = impl->Database.set<String>(impl->aClient, paths_->lastUpdateDate().c_str(), yyyymmdd);
-  return ok1 && ok2;
+  // One update for time, date and a server timestamp (joins an open batch).
+  const bool ownBatch = !batchOpen_;
+  if (ownBatch) beginBatch();
+  batchSetString(paths_->lastUpdateTime(), hhmmss);
+  batchSetString(paths_->lastUpdateDate(), yyyymmdd);
+  batchSetServerTimestamp(paths_->lastUpdateServerTs());
+  return ownBatch ? commitBatch() : true;
 #else
   (void)hhmmss; (void)yyyymmdd; return false;
 #endif
@@ -142,8 +365,12 @@ bool RtdbClientMobizt::getMaxTemp(float &outCelsius) {
 #if USE_MOBIZT_FIREBASE
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  outCelsius = impl->Database.get<float>(impl->aClient, paths_->maxTemp().c_str());
-  return impl->aClient.lastError().code() == 0;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
+  const float value = impl->Database.get<float>(impl->aClient, paths_->maxTemp().c_str());
+  if (!finishSync(impl, startMs)) return false;
+  outCelsius = value;
+  return true;
 #else
   (void)outCelsius; return false;
 #endif
@@ -154,8 +381,12 @@ bool RtdbClientMobizt::getTimerFlag(const String &key, bool &outEnabled) {
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
   String path = paths_->timerKey(key.c_str());
-  outEnabled = impl->Database.get<bool>(impl->aClient, path.c_str());
-  return impl->aClient.lastError().code() == 0;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
+  const bool value = impl->Database.get<bool>(impl->aClient, path.c_str());
+  if (!finishSync(impl, startMs)) return false;
+  outEnabled = value;
+  return true;
 #else
   (void)key; (void)outEnabled; return false;
 #endif
@@ -167,8 +398,12 @@ bool RtdbClientMobizt::getCustomTime(String &outHhmm) {
   if (!impl || !impl->configured) return false;
   // CUSTOM under Timers
   String path = paths_->timersRoot() + "/CUSTOM";
-  outHhmm = impl->Database.get<String>(impl->aClient, path.c_str());
-  return impl->aClient.lastError().code() == 0;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
+  const String value = impl->Database.get<String>(impl->aClient, path.c_str());
+  if (!finishSync(impl, startMs)) return false;
+  outHhmm = value;
+  return true;
 #else
   (void)outHhmm; return false;
 #endif
@@ -178,19 +413,109 @@ bool RtdbClientMobizt::getHysteresis(float &outCelsius) {
 #if USE_MOBIZT_FIREBASE
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  outCelsius = impl->Database.get<float>(impl->aClient, paths_->hysteresisC().c_str());
-  return impl->aClient.lastError().code() == 0;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
+  const float value = impl->Database.get<float>(impl->aClient, paths_->hysteresisC().c_str());
+  if (!finishSync(impl, startMs)) return false;
+  outCelsius = value;
+  return true;
 #else
   (void)outCelsius; return false;
 #endif
 }
 
+bool RtdbClientMobizt::fetchSettings(const SettingsSnapshot &defaults, SettingsSnapshot &out) {
+#if USE_MOBIZT_FIREBASE
+  if (!active_) return false;
+  auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
+  if (!impl || !impl->configured) return false;
+  out = defaults;
+  // Both GETs or neither: a half-done fetch would only be retried anyway.
+  if (!admitSync(impl)) return false;
+  // A missing subtree comes back as "null": every field then takes its default.
+  uint32_t startMs = millis();
+  const String geyser = impl->Database.get<String>(impl->aClient, paths_->geyserRoot().c_str());
+  if (!finishSync(impl, startMs)) {
+    Logger::warn("Settings: GET geyser_1 failed (code=%d)", impl->aClient.lastError().code());
+    return false;
+  }
+  if (!admitSync(impl)) return false;
+  startMs = millis();
+  const String timers = impl->Database.get<String>(impl->aClient, paths_->timersRoot().c_str());
+  if (!finishSync(impl, startMs)) {
+    Logger::warn("Settings: GET Timers failed (code=%d)", impl->aClient.lastError().code());
+    return false;
+  }
+
+  // Parse; collect missing fields into one multi-path update body rooted at root().
+  String patch;
+  const RtdbPaths &paths = *paths_;
+  auto addPatch = [&patch, &paths](const String &path, const String &json) {
+    patch += patch.length() ? "," : "{";
+    patch += jsonQuote(paths.relative(path)) + ":" + json;
+  };
+  if (!JsonScan::readFloat(geyser.c_str(), "max_temp", out.maxTempC)) {
+    addPatch(paths_->maxTemp(), String(defaults.maxTempC, 2));
+  }
+  if (!JsonScan::readFloat(geyser.c_str(), "hysteresis_c", out.hysteresisC)) {
+    addPatch(paths_->hysteresisC(), String(defaults.hysteresisC, 2));
+  }
+  String custom;
+  if (JsonScan::readString(timers.c_str(), "CUSTOM", custom)) {
+    out.setCustomTime(custom.c_str());
+  } else {
+    const char* def = defaults.hasCustomTime() ? defaults.customTime : "05:00";
+    out.setCustomTime(def);
+    addPatch(paths_->timerKey("CUSTOM"), jsonQuote(def));
+  }
+  struct Flag { const char* key; bool SettingsSnapshot::*field; };
+  static const Flag kFlags[] = {
+    {"04:00", &SettingsSnapshot::t0400}, {"06:00", &SettingsSnapshot::t0600},
+    {"08:00", &SettingsSnapshot::t0800}, {"16:00", &SettingsSnapshot::t1600},
+    {"18:00", &SettingsSnapshot::t1800},
+  };
+  for (const Flag &f : kFlags) {
+    if (!JsonScan::readBool(timers.c_str(), f.key, out.*(f.field))) {
+      addPatch(paths_->timerKey(f.key), defaults.*(f.field) ? "true" : "false");
+    }
+  }
+  if (patch.length()) {
+    patch += "}";
+    Logger::info("Settings: creating defaults %s", patch.c_str());
+    if (!submitWrite(RtdbRequestQueue::kUpdate, paths_->root(), patch)) {
+      Logger::warn("Settings: failed to queue defaults");
+    }
+  }
+  return true;
+#else
+  (void)defaults; (void)out; return false;
+#endif
+}
+
+bool RtdbClientMobizt::fetchSettingsRevision(uint32_t &outRevision) {
+#if USE_MOBIZT_FIREBASE
+  if (!active_) return false;
+  auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
+  if (!impl || !impl->configured) return false;
+  // Read as a string so an absent node ("null") is distinguishable from 0.
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
+  const String raw = impl->Database.get<String>(impl->aClient, paths_->settingsVersion().c_str());
+  if (!finishSync(impl, startMs) || raw.length() == 0 || raw == "null") return false;
+  outRevision = (uint32_t)strtoul(raw.c_str(), nullptr, 10);
+  return true;
+#else
+  (void)outRevision; return false;
+#endif
+}
+
 bool RtdbClientMobizt::setStringPath(const String &path, const String &value) {
 #if USE_MOBIZT_FIREBASE
   if (!active_) return false;
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  return impl->Database.set<String>(impl->aClient, path.c_str(), value);
+  if (batchOpen_) return batchSetString(path, value);
+  return submitWrite(RtdbRequestQueue::kSet, path, jsonQuote(value));
 #else
   (void)path; (void)value; return false;
 #endif
@@ -201,31 +526,67 @@ bool RtdbClientMobizt::setIntPath(const String &path, int value) {
   if (!active_) return false;
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  return impl->Database.set<int>(impl->aClient, path.c_str(), value);
+  if (batchOpen_) return batchSetInt(path, value);
+  return submitWrite(RtdbRequestQueue::kSet, path, String(value));
 #else
   (void)path; (void)value; return false;
 #endif
 }
 
+bool RtdbClientMobizt::incrementIntPath(const String &path, int delta) {
+#if USE_MOBIZT_FIREBASE
+  if (!active_) return false;
+  auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
+  if (!impl || !impl->configured) return false;
+  if (batchOpen_) return batchIncrementInt(path, delta);
+  return submitWrite(RtdbRequestQueue::kSet, path, "{\".sv\":{\"increment\":" + String(delta) + "}}");
+#else
+  (void)path; (void)delta; return false;
+#endif
+}
+
 bool RtdbClientMobizt::getIntPath(const String &path, int &outValue) {
 #if USE_MOBIZT_FIREBASE
   if (!active_) return false;
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
-  outValue = impl->Database.get<int>(impl->aClient, path.c_str());
-  return impl->aClient.lastError().code() == 0;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
+  const int value = impl->Database.get<int>(impl->aClient, path.c_str());
+  if (!finishSync(impl, startMs)) return false;
+  outValue = value;
+  return true;
 #else
   (void)path; (void)outValue; return false;
 #endif
 }
 
+bool RtdbClientMobizt::pathExists(const String &path, bool &outExists) {
+#if USE_MOBIZT_FIREBASE
+  if (!active_) return false;
+  auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
+  if (!impl || !impl->configured) return false;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
+  const String raw = impl->Database.get<String>(impl->aClient, path.c_str());
+  if (!finishSync(impl, startMs)) return false;
+  outExists = raw.length() > 0 && raw != "null";
+  return true;
+#else
+  (void)path; (void)outExists; return false;
+#endif
+}
+
 bool RtdbClientMobizt::ensureMaxTemp(float defaultCelsius, float &outCelsius) {
 #if USE_MOBIZT_FIREBASE
   if (!active_) return false;
   if (getMaxTemp(outCelsius)) return true;  // exists
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
   bool ok = impl->Database.set<float>(impl->aClient, paths_->maxTemp().c_str(), defaultCelsius);
+  ok = finishSync(impl, startMs) && ok;
   if (ok) outCelsius = defaultCelsius;
   if (ok) {
     Logger::info("Settings: created default max_temp=%.2f C", defaultCelsius);
@@ -245,7 +606,10 @@ bool RtdbClientMobizt::ensureTimerFlag(const String &key, bool defaultEnabled, b
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
   String path = paths_->timerKey(key.c_str());
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
   bool ok = impl->Database.set<bool>(impl->aClient, path.c_str(), defaultEnabled);
+  ok = finishSync(impl, startMs) && ok;
   if (ok) outEnabled = defaultEnabled;
   if (ok) {
     Logger::info("Settings: created default Timer %s=%s", key.c_str(), defaultEnabled ? "true" : "false");
@@ -265,7 +629,10 @@ bool RtdbClientMobizt::ensureCustomTime(const String &defaultHhmm, String &outHh
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
   String path = paths_->timersRoot() + "/CUSTOM";
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
   bool ok = impl->Database.set<String>(impl->aClient, path.c_str(), defaultHhmm);
+  ok = finishSync(impl, startMs) && ok;
   if (ok) outHhmm = defaultHhmm;
   if (ok) {
     Logger::info("Settings: created default CUSTOM=%s", defaultHhmm.c_str());
@@ -284,7 +651,10 @@ bool RtdbClientMobizt::ensureHysteresis(float defaultCelsius, float &outCelsius)
   if (getHysteresis(outCelsius)) return true;
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
+  if (!admitSync(impl)) return false;
+  const uint32_t startMs = millis();
   bool ok = impl->Database.set<float>(impl->aClient, paths_->hysteresisC().c_str(), defaultCelsius);
+  ok = finishSync(impl, startMs) && ok;
   if (ok) outCelsius = defaultCelsius;
   return ok;
 #else
@@ -295,24 +665,232 @@ bool RtdbClientMobizt::isHealthy() const {
 #if USE_MOBIZT_FIREBASE
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
   if (!impl || !impl->configured) return false;
+  if (breaker_.state() == CircuitBreaker::kOpen) return false;
   uint32_t nowMs = millis();
+#if BUILD_RTDB_COMMAND_STREAM
+  if (commandStream_.healthy(nowMs)) return true;
+#endif
   return (nowMs - impl->lastPollOkMs) <= 5000u;
 #else
   return false;
 #endif
 }
 
+CachingSecureClient::Stats RtdbClientMobizt::connectionStats() const {
+#if USE_MOBIZT_FIREBASE
+  auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
+  if (impl) return impl->ssl_client.stats();
+#endif
+  return CachingSecureClient::Stats{};
+}
+
+void RtdbClientMobizt::beginPass() {
+  pass_.spentMs = 0;
+}
+
+uint8_t RtdbClientMobizt::writeCapacity(uint32_t nowMs) {
+  switch (breaker_.poll(nowMs)) {
+    case CircuitBreaker::kClosed:
+      return BUILD_RTDB_MAX_IN_FLIGHT;
+    case CircuitBreaker::kHalfOpen: {
+      // One queued write may serve as the probe; the rest wait for its result.
+      const RtdbRequestQueue::Stats &st = requests_.stats();
+      return st.inFlight == 0 && st.pending && breaker_.allow(nowMs) ? 1 : 0;
+    }
+    case CircuitBreaker::kOpen:
+      break;
+  }
+  return 0;  // open: queued writes wait; in-flight ones still time out
+}
+
 void RtdbClientMobizt::activate(bool on) {
 #if USE_MOBIZT_FIREBASE
   active_ = on;
+#if BUILD_RTDB_COMMAND_STREAM
+  // Drop the stream while inactive; loop() resubscribes on reactivation.
+  if (!on) commandStream_.stop();
+#endif
+#else
+  (void)on;
+#endif
+}
+
+// ---- Write batch --------------------------------------------------------------
+
+
+void RtdbClientMobizt::beginBatch() {
+  batchOpen_ = true;
+  batchGrouped_ = false;
+  batchTracker_ = nullptr;
+  batchCount_ = 0;
+  batchBody_.remove(0);
+}
+
+void RtdbClientMobizt::batchBeginGroup() {
+  batchGrouped_ = batchOpen_;
+}
+
+void RtdbClientMobizt::batchEndGroup() {
+  if (!batchGrouped_) return;
+  batchGrouped_ = false;
+  if (batchBody_.length() >= BUILD_RTDB_BATCH_MAX_BYTES) flushBatch();
+}
+
+bool RtdbClientMobizt::batchAdd(const String &path, const String &json) {
+  // Keys are relative to root(); anything outside it is written directly.
+  const String key = paths_ ? paths_->relative(path) : String();
+  if (key.length() == 0) {
+    Logger::warn("RTDB: batch path outside root, skipped: %s", path.c_str());
+    return false;
+  }
+  if (batchBody_.length()) batchBody_ += ",";
+  batchBody_ += jsonQuote(key);
+  batchBody_ += ":";
+  batchBody_ += json;
+  batchCount_++;
+  if (!batchGrouped_ && batchBody_.length() >= BUILD_RTDB_BATCH_MAX_BYTES) return flushBatch();
+  return true;
+}
+
+bool RtdbClientMobizt::batchSetString(const String &path, const String &value) {
+  if (!batchOpen_) return setStringPath(path, value);
+  return batchAdd(path, jsonQuote(value));
+}
+
+bool RtdbClientMobizt::batchSetInt(const String &path, int value) {
+  if (!batchOpen_) return setIntPath(path, value);
+  return batchAdd(path, String(value));
+}
+
+bool RtdbClientMobizt::batchSetFloat(const String &path, float value) {
+  if (!batchOpen_) return submitWrite(RtdbRequestQueue::kSet, path, String(value, 2));
+  return batchAdd(path, String(value, 2));
+}
+
+bool RtdbClientMobizt::batchSetNumbers(const String &path, const char* const* keys, const float* values,
+                                       uint8_t n) {
+  // One member holding the whole object keeps the batch body small.
+  String json = "{";
+  for (uint8_t i = 0; i < n; i++) {
+    if (i) json += ",";
+    json += jsonQuote(keys[i]);
+    json += ":";
+    json += String(values[i], 2);
+  }
+  json += "}";
+  if (!batchOpen_) return submitWrite(RtdbRequestQueue::kSet, path, json);
+  return batchAdd(path, json);
+}
+
+uint16_t RtdbClientMobizt::streamHistory(CompressedHistory::Cursor &cursor, uint16_t maxPoints) {
+  if (!paths_) return 0;
+  static const char* const kKeys[] = {"mean", "relay"};
+  CompressedHistory::Point p;
+  uint16_t sent = 0;
+  while (sent < maxPoints && cursor.next(p)) {
+    time_t sec = (time_t)p.epochSec;
+    struct tm lt;
+    if (!localtime_r(&sec, &lt)) continue;
+    char date[11];
+    char hhmm[6];
+    strftime(date, sizeof(date), "%Y-%m-%d", &lt);
+    strftime(hhmm, sizeof(hhmm), "%H:%M", &lt);
+    const float values[] = {p.tempC, p.relayOn ? 1.0f : 0.0f};
+    if (!batchSetNumbers(paths_->temperatureDay(String(date)) + "/" + hhmm, kKeys, values, 2)) break;
+    sent++;
+  }
+  return sent;
+}
+
+bool RtdbClientMobizt::batchIncrementInt(const String &path, int delta) {
+  if (!batchOpen_) return incrementIntPath(path, delta);
+  return batchAdd(path, "{\".sv\":{\"increment\":" + String(delta) + "}}");
+}
+
+bool RtdbClientMobizt::batchSetServerTimestamp(const String &path) {
+  if (!batchOpen_) return false;
+  return batchAdd(path, "{\".sv\":\"timestamp\"}");
+}
+
+bool RtdbClientMobizt::flushBatch() {
+  if (batchBody_.length() == 0) return true;
+#if USE_MOBIZT_FIREBASE
   auto *impl = reinterpret_cast<FirebaseImpl*>(impl_);
-  if (impl) {
-    (void)on;
+  bool ok = false;
+  if (batchOpen_ && !batchTracker_) {
+    for (auto &t : trackers_) {
+      if (t.used) continue;
+      t = BatchTracker{};
+      t.used = true;
+      batchTracker_ = &t;
+      break;
+    }
+  }
+  if (active_ && impl && impl->configured) {
+    ok = submitWrite(RtdbRequestQueue::kUpdate, paths_->root(), "{" + batchBody_ + "}",
+                     batchTracker_ ? &RtdbClientMobizt::onBatchWrite : nullptr, batchTracker_);
+  }
+  if (batchTracker_) {
+    if (ok) batchTracker_->outstanding++;
+    else batchTracker_->failed = true;
   }
 #else
-  (void)on;
+  const bool ok = false;
 #endif
+  batchBody_.remove(0);
+  batchCount_ = 0;
+  return ok;
+}
+
+bool RtdbClientMobizt::commitBatch() {
+  return commitBatchWithAck(nullptr, nullptr);
+}
+
+bool RtdbClientMobizt::commitBatchWithAck(WriteDone done, void* ctx) {
+  const bool ok = flushBatch();
+  batchOpen_ = false;
+  batchGrouped_ = false;
+  BatchTracker* t = batchTracker_;
+  batchTracker_ = nullptr;
+  if (!t) {
+    // Nothing was flushed (empty batch), or no tracker could be taken.
+    if (done) done(ok, ctx);
+    return ok;
+  }
+  t->done = done;
+  t->ctx = ctx;
+  t->sealed = true;
+  settleTracker(*t);
+  return ok;
 }
 
+void RtdbClientMobizt::onBatchWrite(bool ok, int code, void* ctx) {
+  (void)code;
+  auto *t = static_cast<BatchTracker*>(ctx);
+  if (!t || !t->used) return;
+  if (t->outstanding) t->outstanding--;
+  if (!ok) t->failed = true;
+  settleTracker(*t);
+}
 
+void RtdbClientMobizt::settleTracker(BatchTracker &t) {
+  if (!t.sealed || t.outstanding) return;
+  WriteDone done = t.done;
+  void* ctx = t.ctx;
+  const bool ok = !t.failed;
+  t.used = false;
+  if (done) done(ok, ctx);
+}
 
+bool RtdbClientMobizt::submitWrite(RtdbRequestQueue::Method method, const String &path, const String &json,
+                                   RtdbRequestQueue::Completion done, void* doneCtx) {
+#if USE_MOBIZT_FIREBASE
+  if (requests_.submit(method, path, json, done, doneCtx, millis())) return true;
+  const RtdbRequestQueue::Stats &st = requests_.stats();
+  Logger::warn("RTDB: request table full, dropped write to %s (in flight=%u, pending=%u, rejected=%u)",
+               path.c_str(), (unsigned)st.inFlight, (unsigned)st.pending, (unsigned)st.rejected);
+  return false;
+#else
+  (void)method; (void)path; (void)json; (void)done; (void)doneCtx; return false;
+#endif
+}
@@ -10,8 +10,12 @@
 #include "src/config/BuildConfig.h"
 #include "src/config/Secrets.h"
 #include "src/config/RtdbPaths.h"
+#include "src/infrastructure/CachingSecureClient.h"
+#include "src/infrastructure/CircuitBreaker.h"
+#include "src/infrastructure/CommandStream.h"
 #include "src/infrastructure/Logger.h"
 #include "src/infrastructure/RemoteBackend.h"
+#include "src/infrastructure/RtdbRequestQueue.h"
 
 
 // Intentionally avoid including FirebaseClient headers here to keep the
@@ -30,13 +34,43 @@ class RtdbClientMobizt : public RemoteBackend {
   // Activate/deactivate backend (controls subscribing/stream processing).
   void activate(bool on) override;
 
-  // RTDB health probe used by mode manager.
-  bool isHealthy() const;
-
-  // Publish helpers. Return true on success (when enabled), false otherwise.
+  // RTDB health: false while the circuit is open or the server has not been
+  // heard from recently.
+  bool isHealthy() const override;
+
+  // Resets the blocking-time budget at the start of a network task pass.
+  // Synchronous calls are only started while a whole sync timeout still fits
+  // in BUILD_RTDB_PASS_BUDGET_MS; later ones fail fast until the next pass.
+  void beginPass() override;
+
+  struct PassStats {
+    uint32_t spentMs = 0;     // blocking time in the current pass
+    uint32_t maxSpentMs = 0;  // worst pass so far
+    uint32_t deferred = 0;    // calls refused because the pass budget was used up
+  };
+  const PassStats &passStats() const { return pass_; }
+
+  // Circuit breaker over every request (sync calls and async writes). While
+  // open, sync calls fail immediately and queued writes wait in requests_.
+  CircuitBreaker::State breakerState() const { return breaker_.state(); }
+  const CircuitBreaker::Stats &breakerStats() const { return breaker_.stats(); }
+
+  // Handshake, reuse and DNS counters of the request connection.
+  CachingSecureClient::Stats connectionStats() const;
+
+  // Writes are asynchronous: they are queued in requests_ and issued from
+  // loop() with a bounded number in flight. BUILD_RTDB_MAX_IN_FLIGHT bounds
+  // the tasks queued in the library's client, which sends them one after
+  // another on its single connection; synchronous GETs use the same client
+  // and only start once none is in flight. Counters for the queue:
+  const RtdbRequestQueue::Stats &requestStats() const { return requests_.stats(); }
+
+  // Publish helpers. Return true when the write was accepted (queued or
+  // batched), false when disabled or the request table is full.
   bool publishTempC(float tempC) override;
   bool publishRelayState(bool on) override;
   bool publishLastUpdate(const String& hhmmss, const String& yyyymmdd) override;
+  bool publishProbeTempC(uint8_t probe, float tempC) override;
 
   // Subscribe to live relay state changes; callback invoked with desired state.
   void subscribeRelayCommand(RelayCallback onChange, void* ctx) override;
@@ -54,16 +88,73 @@ class RtdbClientMobizt : public RemoteBackend {
   bool ensureCustomTime(const String &defaultHhmm, String &outHhmm) override;
   bool ensureHysteresis(float defaultCelsius, float &outCelsius) override;
 
+  // Bulk settings: one GET for Geysers/geyser_1, one for Timers, and a single
+  // multi-path update when defaults have to be created.
+  bool fetchSettings(const SettingsSnapshot &defaults, SettingsSnapshot &out) override;
+  // Reads the integer at settingsVersion (a few bytes); false when it is absent.
+  bool fetchSettingsRevision(uint32_t &outRevision) override;
+
   // Generic path writers for app-side composite writes (usage records)
   bool setStringPath(const String &path, const String &value) override;
   bool setIntPath(const String &path, int value) override;
   bool getIntPath(const String &path, int &outValue) override;
+  // One GET read as a string, so an absent node ("null") is told apart from 0.
+  bool pathExists(const String &path, bool &outExists) override;
+  // Server-side {".sv":{"increment":delta}}: one write, safe with concurrent writers.
+  bool incrementIntPath(const String &path, int delta) override;
+
+  // Write batch sent as one multi-location update rooted at RtdbPaths::root().
+  void beginBatch() override;
+  void batchBeginGroup() override;
+  void batchEndGroup() override;
+  bool batchSetString(const String &path, const String &value) override;
+  bool batchSetInt(const String &path, int value) override;
+  bool batchSetFloat(const String &path, float value) override;
+  // Points go to Records/Temperature/<date>/<HH:MM> as {mean, relay}.
+  uint16_t streamHistory(CompressedHistory::Cursor &cursor, uint16_t maxPoints) override;
+  bool batchSetNumbers(const String &path, const char* const* keys, const float* values, uint8_t n) override;
+  bool batchIncrementInt(const String &path, int delta) override;
+  bool batchSetServerTimestamp(const String &path) override;
+  bool commitBatch() override;
+  bool commitBatchWithAck(WriteDone done, void* ctx) override;
 
  private:
   const RtdbPaths* paths_ = nullptr;
   RelayCallback relayCallback_ = nullptr;
   void* relayCtx_ = nullptr;
   bool active_ = true;
+  // Open write batch: JSON members keyed relative to root(), without braces.
+  bool batchOpen_ = false;
+  bool batchGrouped_ = false;  // size-based flushes wait for batchEndGroup()
+  uint8_t batchCount_ = 0;
+  String batchBody_;
+  bool batchAdd(const String &path, const String &json);
+  bool flushBatch();
+
+  // Completion tracking for a batch that may flush several updates. One per
+  // request slot, so a tracker is always free while the table has room.
+  struct BatchTracker {
+    uint8_t outstanding = 0;  // submitted updates without a result yet
+    bool failed = false;
+    bool sealed = false;      // commit seen; report when outstanding hits 0
+    bool used = false;
+    WriteDone done = nullptr;
+    void* ctx = nullptr;
+  };
+  BatchTracker trackers_[RtdbRequestQueue::kSlots];
+  BatchTracker* batchTracker_ = nullptr;  // tracker of the open batch (first flush)
+  static void onBatchWrite(bool ok, int code, void* ctx);
+  static void settleTracker(BatchTracker &t);
+
+  RtdbRequestQueue requests_;
+  CommandStream commandStream_;
+  CircuitBreaker breaker_;
+  PassStats pass_{};
+  uint8_t writeCapacity(uint32_t nowMs);
+  // Command stream upkeep, and the fallback GET while the stream is down.
+  void pollCommand(uint32_t nowMs);
+  bool submitWrite(RtdbRequestQueue::Method method, const String &path, const String &json,
+                   RtdbRequestQueue::Completion done = nullptr, void* doneCtx = nullptr);
 
 #if USE_MOBIZT_FIREBASE
   // Opaque impl to avoid exposing library types in the header
@@ -0,0 +1,110 @@
+// RtdbRequestQueue.cpp
+
+#include "RtdbRequestQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void RtdbRequestQueue::configure(uint8_t maxInFlight, uint32_t timeoutMs, IssueFn issue, CancelFn cancel, void* ctx) {
+  maxInFlight_ = maxInFlight ? maxInFlight : 1;
+  timeoutMs_ = timeoutMs;
+  issue_ = issue;
+  cancel_ = cancel;
+  hookCtx_ = ctx;
+}
+
+bool RtdbRequestQueue::submit(Method method, const String &path, const String &body,
+                              Completion done, void* doneCtx, uint32_t nowMs) {
+  for (uint8_t i = 0; i < kSlots; i++) {
+    Request &r = slots_[i];
+    if (r.state != kFree) continue;
+    r.method = method;
+    r.path = path;
+    r.body = body;
+    r.done = done;
+    r.ctx = doneCtx;
+    r.queuedMs = nowMs;
+    r.issuedMs = 0;
+    r.seq = nextSeq_++;
+    if (nextSeq_ == 0) nextSeq_ = 1;
+    r.state = kPending;
+    stats_.submitted++;
+    stats_.pending++;
+    return true;
+  }
+  stats_.rejected++;
+  return false;
+}
+
+int RtdbRequestQueue::oldestPending() const {
+  int best = -1;
+  for (uint8_t i = 0; i < kSlots; i++) {
+    if (slots_[i].state != kPending) continue;
+    // Wrap-safe sequence comparison keeps FIFO order.
+    if (best < 0 || (int16_t)(slots_[i].seq - slots_[best].seq) < 0) best = i;
+  }
+  return best;
+}
+
+void RtdbRequestQueue::pump(uint32_t nowMs, uint8_t issueCap) {
+  char uid[kUidLen];
+  for (uint8_t i = 0; i < kSlots; i++) {
+    Request &r = slots_[i];
+    if (r.state != kInFlight || nowMs - r.issuedMs < timeoutMs_) continue;
+    formatUid(uid, i, r.seq);
+    if (cancel_) cancel_(uid, hookCtx_);
+    stats_.timedOut++;
+    finish(i, false, -1, nowMs);
+  }
+  const uint8_t cap = issueCap < maxInFlight_ ? issueCap : maxInFlight_;
+  while (stats_.inFlight < cap) {
+    const int i = oldestPending();
+    if (i < 0) break;
+    Request &r = slots_[i];
+    formatUid(uid, (uint8_t)i, r.seq);
+    r.state = kInFlight;
+    r.issuedMs = nowMs;
+    stats_.pending--;
+    stats_.inFlight++;
+    if (stats_.inFlight > stats_.maxInFlightSeen) stats_.maxInFlightSeen = stats_.inFlight;
+    if (!issue_ || !issue_(r, uid, hookCtx_)) finish((uint8_t)i, false, -2, nowMs);
+  }
+}
+
+void RtdbRequestQueue::complete(const char* uid, bool ok, int code, uint32_t nowMs) {
+  // uid format: "rq<slot>.<seq>"
+  if (!uid || uid[0] != 'r' || uid[1] != 'q') return;
+  char* dot = nullptr;
+  const unsigned long slot = strtoul(uid + 2, &dot, 10);
+  if (!dot || *dot != '.' || slot >= kSlots) return;
+  const unsigned long seq = strtoul(dot + 1, nullptr, 10);
+  Request &r = slots_[slot];
+  if (r.state != kInFlight || r.seq != (uint16_t)seq) return;  // stale (e.g. already timed out)
+  finish((uint8_t)slot, ok, code, nowMs);
+}
+
+void RtdbRequestQueue::finish(uint8_t slot, bool ok, int code, uint32_t nowMs) {
+  Request &r = slots_[slot];
+  if (r.state == kInFlight) stats_.inFlight--;
+  else if (r.state == kPending) stats_.pending--;
+  if (ok) {
+    stats_.completed++;
+  } else if (code != -1) {
+    stats_.failed++;
+  }
+  const uint32_t latency = nowMs - r.queuedMs;
+  stats_.lastLatencyMs = latency;
+  if (latency > stats_.maxLatencyMs) stats_.maxLatencyMs = latency;
+  const Completion done = r.done;
+  void* ctx = r.ctx;
+  r.state = kFree;
+  r.path.remove(0);
+  r.body.remove(0);
+  r.done = nullptr;
+  r.ctx = nullptr;
+  if (done) done(ok, code, ctx);
+}
+
+void RtdbRequestQueue::formatUid(char* out, uint8_t slot, uint16_t seq) {
+  snprintf(out, kUidLen, "rq%u.%u", (unsigned)slot, (unsigned)seq);
+}
@@ -0,0 +1,85 @@
+// RtdbRequestQueue.h
+// Library-agnostic bookkeeping for asynchronous RTDB writes: a fixed table of
+// requests, FIFO issue with a bounded number in flight, per-request timeouts
+// and completion callbacks. The client supplies the issue/cancel hooks that
+// talk to the actual database library and reports completions by uid.
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "src/config/BuildConfig.h"
+
+class RtdbRequestQueue {
+ public:
+  // Completion callback: ok=false with code=-1 means the request timed out.
+  using Completion = void (*)(bool ok, int code, void* ctx);
+
+  enum Method : uint8_t { kSet, kUpdate };
+
+  struct Request {
+    Method method = kSet;
+    String path;
+    String body;             // JSON value (set) or object (update)
+    Completion done = nullptr;
+    void* ctx = nullptr;
+    uint32_t queuedMs = 0;
+    uint32_t issuedMs = 0;
+    uint16_t seq = 0;
+    uint8_t state = 0;       // kFree / kPending / kInFlight
+  };
+
+  // Sends a request; uid must be echoed back through complete(). Returns false
+  // if the request could not be handed to the library.
+  using IssueFn = bool (*)(const Request &req, const char* uid, void* ctx);
+  // Abandons an in-flight request (after a timeout).
+  using CancelFn = void (*)(const char* uid, void* ctx);
+
+  struct Stats {
+    uint32_t submitted = 0;
+    uint32_t completed = 0;      // successful
+    uint32_t failed = 0;         // error reported by the library or issue failure
+    uint32_t timedOut = 0;
+    uint32_t rejected = 0;       // table full at submit
+    uint8_t pending = 0;
+    uint8_t inFlight = 0;
+    uint8_t maxInFlightSeen = 0;
+    uint32_t lastLatencyMs = 0;  // queued -> completed
+    uint32_t maxLatencyMs = 0;
+  };
+
+  static constexpr uint8_t kSlots = BUILD_RTDB_REQUEST_SLOTS;
+  static constexpr size_t kUidLen = 16;
+
+  void configure(uint8_t maxInFlight, uint32_t timeoutMs, IssueFn issue, CancelFn cancel, void* ctx);
+
+  // Queues a write; never blocks. Returns false when all slots are busy.
+  bool submit(Method method, const String &path, const String &body,
+              Completion done, void* doneCtx, uint32_t nowMs);
+
+  // Expires timed-out requests and issues pending ones up to the in-flight
+  // bound, lowered to issueCap when the caller is throttling (0 = expire only).
+  void pump(uint32_t nowMs, uint8_t issueCap = UINT8_MAX);
+
+  // Reports the library's result for uid (unknown or stale uids are ignored).
+  void complete(const char* uid, bool ok, int code, uint32_t nowMs);
+
+  bool idle() const { return stats_.pending == 0 && stats_.inFlight == 0; }
+  const Stats &stats() const { return stats_; }
+
+ private:
+  enum State : uint8_t { kFree = 0, kPending, kInFlight };
+
+  Request slots_[kSlots];
+  uint16_t nextSeq_ = 1;
+  uint8_t maxInFlight_ = 1;
+  uint32_t timeoutMs_ = 10000;
+  IssueFn issue_ = nullptr;
+  CancelFn cancel_ = nullptr;
+  void* hookCtx_ = nullptr;
+  Stats stats_{};
+
+  int oldestPending() const;
+  void finish(uint8_t slot, bool ok, int code, uint32_t nowMs);
+  static void formatUid(char* out, uint8_t slot, uint16_t seq);
+};
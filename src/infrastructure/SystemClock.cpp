@@ -12,12 +12,14 @@ void SystemClock::begin(const char* tz) {
 
 bool SystemClock::waitForTime(uint32_t timeoutMs) {
   const uint32_t start = millis();
-  time_t t = time(nullptr);
-  while ((t < 8 * 3600 * 2) && (millis() - start < timeoutMs)) {
+  while (!isSynced() && (millis() - start < timeoutMs)) {
     delay(50);
-    t = time(nullptr);
   }
-  return t >= 8 * 3600 * 2;  // arbitrary threshold: time set if > Jan 1, 1970
+  return isSynced();
+}
+
+bool SystemClock::isSynced() const {
+  return time(nullptr) >= 8 * 3600 * 2;  // arbitrary threshold: time set if > Jan 1, 1970
 }
 
 time_t SystemClock::now() const {
@@ -15,6 +15,9 @@ class SystemClock {
 
   // Returns current epoch seconds or 0 if not available.
   time_t now() const;
+
+  // True once the clock has been set (by SNTP); before that now() counts from boot.
+  bool isSynced() const;
 };
 
 
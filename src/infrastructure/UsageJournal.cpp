@@ -0,0 +1,277 @@
+// UsageJournal.cpp
+
+#include "UsageJournal.h"
+
+#include <LittleFS.h>
+#include <string.h>
+
+#include "src/infrastructure/Logger.h"
+
+namespace {
+const char* kPath = "/usage.jnl";
+const char* kTmpPath = "/usage.tmp";
+constexpr uint8_t kMagic = 0xA5;
+constexpr uint8_t kTypeEntry = 1;
+constexpr uint8_t kTypeAck = 2;
+constexpr uint32_t kHeaderLen = 8;  // magic, type, len (2), seq (4)
+constexpr uint32_t kCrcLen = 4;
+constexpr uint32_t kEntryRecordLen = kHeaderLen + sizeof(UsageJournal::Entry) + kCrcLen;
+constexpr uint32_t kAckRecordLen = kHeaderLen + kCrcLen;
+}  // namespace
+
+bool UsageJournal::begin() {
+#if BUILD_ENABLE_USAGE_JOURNAL
+  if (ready_) return true;
+  if (!LittleFS.begin(true)) {
+    Logger::error("Journal: LittleFS mount failed, usage records kept in RAM only");
+    return false;
+  }
+  settleTmp();
+  ready_ = true;
+  recover();
+  Logger::info("Journal: %u pending, open cycle=%s, %u bytes (torn=%u)", (unsigned)pendingCount_,
+               hasOpen_ ? "yes" : "no", (unsigned)size_, (unsigned)stats_.tornBytes);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool UsageJournal::settleTmp() {
+  // A temp file next to a journal is an interrupted compaction: the journal
+  // is still authoritative. A temp file alone was complete but not renamed.
+  if (!LittleFS.exists(kTmpPath)) return true;
+  if (LittleFS.exists(kPath)) return LittleFS.remove(kTmpPath);
+  return LittleFS.rename(kTmpPath, kPath);
+}
+
+bool UsageJournal::recover() {
+  File f = LittleFS.open(kPath, FILE_READ);
+  if (!f) return true;  // first boot
+  const uint32_t total = f.size();
+  uint32_t off = 0;
+  while (off + kAckRecordLen <= total) {
+    uint8_t hdr[kHeaderLen];
+    if (f.read(hdr, kHeaderLen) != kHeaderLen) break;
+    const uint8_t type = hdr[1];
+    const uint16_t len = (uint16_t)(hdr[2] | (hdr[3] << 8));
+    uint32_t seq;
+    memcpy(&seq, hdr + 4, sizeof(seq));
+    if (hdr[0] != kMagic) break;
+    if (!((type == kTypeEntry && len == sizeof(Entry)) || (type == kTypeAck && len == 0))) break;
+    Entry e;
+    if (len && f.read(reinterpret_cast<uint8_t*>(&e), len) != len) break;
+    uint32_t stored = 0;
+    if (f.read(reinterpret_cast<uint8_t*>(&stored), kCrcLen) != kCrcLen) break;
+    const uint32_t crc = crc32(crc32(0, hdr, kHeaderLen), reinterpret_cast<const uint8_t*>(&e), len);
+    if (crc != stored) break;
+    if (type == kTypeEntry) {
+      trackPending(seq, off);
+      trackCycle(e);
+      if (seq >= nextSeq_) nextSeq_ = seq + 1;
+    } else {
+      dropPending(seq);
+    }
+    off += kHeaderLen + len + kCrcLen;
+  }
+  f.close();
+  size_ = off;
+  stats_.bytes = size_;
+  stats_.tornBytes = total - off;
+  stats_.recovered = pendingCount_;
+  // Drop the torn tail (appends would otherwise land behind it, where the
+  // next recovery never reaches them) and start the session with a small file.
+  tornTail_ = off < total;
+  if (tornTail_ || size_ >= BUILD_JOURNAL_MAX_BYTES / 2) return compact();
+  return true;
+}
+
+bool UsageJournal::append(Entry &entry) {
+  if (!ready_) return false;
+  if (tornTail_ && !compact()) return false;  // never append behind a torn record
+  if (size_ + kEntryRecordLen > BUILD_JOURNAL_MAX_BYTES) compact();
+  if (!ready_) return false;  // compaction gave up on the file
+  entry.seq = nextSeq_++;
+  File f = LittleFS.open(kPath, FILE_APPEND);
+  const bool ok = f && writeRecord(f, kTypeEntry, entry.seq, &entry, sizeof(Entry));
+  if (f) f.close();
+  size_ += kEntryRecordLen;
+  if (!ok) {
+    tornTail_ = true;
+    compact();  // rewrite from the table rather than leave a torn record mid-file
+    return false;
+  }
+  trackPending(entry.seq, size_ - kEntryRecordLen);  // evicts the oldest when full
+  trackCycle(entry);
+  stats_.appended++;
+  stats_.bytes = size_;
+  return true;
+}
+
+bool UsageJournal::ack(uint32_t seq) {
+  if (!ready_ || !dropPending(seq)) return false;
+  stats_.acked++;
+  if (tornTail_ || size_ + kAckRecordLen > BUILD_JOURNAL_MAX_BYTES) {
+    if (compact()) return true;  // the rewrite leaves the acked entry out
+    if (!ready_ || tornTail_) return false;
+    // Compaction failed: record the ack anyway, past the soft size cap.
+  }
+  File f = LittleFS.open(kPath, FILE_APPEND);
+  const bool ok = f && writeRecord(f, kTypeAck, seq, nullptr, 0);
+  if (f) f.close();
+  size_ += kAckRecordLen;
+  if (!ok) {
+    tornTail_ = true;
+    return compact();
+  }
+  stats_.bytes = size_;
+  return true;
+}
+
+void UsageJournal::forEachPending(Visitor visit, void* ctx) {
+  if (!ready_ || !visit || pendingCount_ == 0) return;
+  File f = LittleFS.open(kPath, FILE_READ);
+  if (!f) return;
+  Entry e;
+  for (uint16_t i = 0; i < pendingCount_; i++) {
+    if (readEntryAt(f, pending_[i].offset, e)) visit(e, ctx);
+  }
+  f.close();
+}
+
+bool UsageJournal::openCycle(Entry &out) const {
+  if (!hasOpen_) return false;
+  out = open_;
+  return true;
+}
+
+bool UsageJournal::compact() {
+  // Copy pending entries in seq order; the open cycle's start is kept (with
+  // its ack) even when delivered so recovery can still close the cycle.
+  File in = LittleFS.open(kPath, FILE_READ);
+  File out = LittleFS.open(kTmpPath, FILE_WRITE);
+  if (!out) {
+    if (in) in.close();
+    stats_.writeErrors++;
+    return false;
+  }
+  // The new index is built aside (offsets into the temp file) and only
+  // replaces pending_ once the temp file is the journal.
+  bool ok = true;
+  bool keepOpen = hasOpen_ && !isPending(open_.seq);
+  uint32_t off = 0;
+  uint16_t kept = 0;
+  Entry e;
+  for (uint16_t i = 0; ok && i <= pendingCount_; i++) {
+    const bool last = i == pendingCount_;
+    if (keepOpen && (last || pending_[i].seq > open_.seq)) {
+      ok = writeRecord(out, kTypeEntry, open_.seq, &open_, sizeof(Entry)) &&
+           writeRecord(out, kTypeAck, open_.seq, nullptr, 0);
+      off += kEntryRecordLen + kAckRecordLen;
+      keepOpen = false;
+    }
+    if (last || !ok) break;
+    if (!in || !readEntryAt(in, pending_[i].offset, e)) continue;  // unreadable: nothing to keep
+    ok = writeRecord(out, kTypeEntry, e.seq, &e, sizeof(Entry));
+    staged_[kept].seq = e.seq;
+    staged_[kept].offset = off;
+    kept++;
+    off += kEntryRecordLen;
+  }
+  out.close();
+  if (in) in.close();
+  if (!ok) {
+    // The journal is untouched and pending_ still indexes it.
+    LittleFS.remove(kTmpPath);
+    Logger::warn("Journal: compaction failed (errors=%u)", (unsigned)stats_.writeErrors);
+    return false;
+  }
+  LittleFS.remove(kPath);
+  if (!LittleFS.rename(kTmpPath, kPath) && !settleTmp()) {
+    // The complete copy is left as the temp file, which begin() adopts at
+    // the next boot. Neither index matches a journal file now, so stop
+    // journaling for this session rather than ack/replay the wrong records.
+    stats_.writeErrors++;
+    ready_ = false;
+    Logger::error("Journal: compaction rename failed, journal off until reboot");
+    return false;
+  }
+  memcpy(pending_, staged_, kept * sizeof(Pending));
+  pendingCount_ = kept;
+  stats_.pending = pendingCount_;
+  size_ = off;
+  stats_.bytes = size_;
+  tornTail_ = false;
+  stats_.compactions++;
+  return true;
+}
+
+bool UsageJournal::writeRecord(fs::File &file, uint8_t type, uint32_t seq, const void* payload, uint16_t len) {
+  uint8_t hdr[kHeaderLen] = {kMagic, type, (uint8_t)(len & 0xFF), (uint8_t)(len >> 8)};
+  memcpy(hdr + 4, &seq, sizeof(seq));
+  const uint8_t* body = static_cast<const uint8_t*>(payload);
+  const uint32_t crc = crc32(crc32(0, hdr, kHeaderLen), body, len);
+  bool ok = file.write(hdr, kHeaderLen) == kHeaderLen;
+  if (ok && len) ok = file.write(body, len) == len;
+  if (ok) ok = file.write(reinterpret_cast<const uint8_t*>(&crc), kCrcLen) == kCrcLen;
+  if (!ok) stats_.writeErrors++;
+  return ok;
+}
+
+bool UsageJournal::readEntryAt(fs::File &file, uint32_t offset, Entry &out) {
+  // Records were CRC-checked at recovery or written this session; only the
+  // framing is re-checked here.
+  uint8_t hdr[kHeaderLen];
+  if (!file.seek(offset) || file.read(hdr, kHeaderLen) != kHeaderLen) return false;
+  if (hdr[0] != kMagic || hdr[1] != kTypeEntry) return false;
+  return file.read(reinterpret_cast<uint8_t*>(&out), sizeof(Entry)) == sizeof(Entry);
+}
+
+bool UsageJournal::isPending(uint32_t seq) const {
+  for (uint16_t i = 0; i < pendingCount_; i++) {
+    if (pending_[i].seq == seq) return true;
+  }
+  return false;
+}
+
+void UsageJournal::trackPending(uint32_t seq, uint32_t offset) {
+  if (pendingCount_ >= BUILD_JOURNAL_MAX_PENDING) {
+    memmove(pending_, pending_ + 1, (pendingCount_ - 1) * sizeof(Pending));
+    pendingCount_--;
+    stats_.evicted++;
+  }
+  pending_[pendingCount_].seq = seq;
+  pending_[pendingCount_].offset = offset;
+  pendingCount_++;
+  stats_.pending = pendingCount_;
+}
+
+bool UsageJournal::dropPending(uint32_t seq) {
+  for (uint16_t i = 0; i < pendingCount_; i++) {
+    if (pending_[i].seq != seq) continue;
+    memmove(pending_ + i, pending_ + i + 1, (pendingCount_ - i - 1) * sizeof(Pending));
+    pendingCount_--;
+    stats_.pending = pendingCount_;
+    return true;
+  }
+  return false;
+}
+
+void UsageJournal::trackCycle(const Entry &e) {
+  if (e.kind == kStart) {
+    open_ = e;
+    hasOpen_ = true;
+  } else if (hasOpen_ && e.cycleId == open_.cycleId) {
+    hasOpen_ = false;
+  }
+}
+
+uint32_t UsageJournal::crc32(uint32_t crc, const uint8_t* data, size_t len) {
+  // Bitwise CRC-32 (reflected, poly 0xEDB88320); records are tiny and rare.
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
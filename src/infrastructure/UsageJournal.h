@@ -0,0 +1,98 @@
+// UsageJournal.h
+// Append-only LittleFS journal of usage-cycle records so start/end events
+// survive a reboot until the uploader confirms them.
+// - Records: [magic, type, len, seq][payload][crc32]; entries and acks share the file
+// - Recovery scans the whole file once at boot and stops at the first
+//   torn/corrupt record; acks are spread through the file, and the size cap
+//   (BUILD_JOURNAL_MAX_BYTES) keeps the scan to a few hundred records
+// - A torn tail is dropped by compaction before anything is appended again
+// - Compaction rewrites only unacknowledged entries (plus the open cycle's
+//   start) to a temp file and renames it over the journal
+// - Single-task use (network task after begin()); not thread-safe
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include "src/config/BuildConfig.h"
+
+class UsageJournal {
+ public:
+  enum Kind : uint8_t { kStart = 1, kEnd = 2 };
+
+  // Fixed-size payload of an entry record (written as-is; device-local format).
+  struct Entry {
+    uint32_t seq = 0;          // assigned by append(); never 0 for a stored entry
+    uint8_t kind = kStart;
+    uint32_t cycleId = 0;
+    uint32_t durationSec = 0;  // kEnd only
+    uint32_t epochSec = 0;     // wall clock at the event (0 = clock not set)
+    char date[11] = {};        // YYYY-MM-DD
+    char time[9] = {};         // HH:MM
+    char reason[16] = {};
+    char instruction[16] = {};
+  };
+
+  struct Stats {
+    uint32_t appended = 0;
+    uint32_t acked = 0;
+    uint32_t recovered = 0;     // pending entries found at boot
+    uint32_t tornBytes = 0;     // bytes discarded after the last valid record at boot
+    uint32_t compactions = 0;
+    uint32_t evicted = 0;       // pending entries forgotten because the table was full
+    uint32_t writeErrors = 0;
+    uint32_t bytes = 0;         // current journal size
+    uint16_t pending = 0;
+  };
+
+  using Visitor = void (*)(const Entry &entry, void* ctx);
+
+  // Mounts LittleFS (formatting on first use) and recovers the journal.
+  // Returns false when disabled or the filesystem is unavailable; every other
+  // call is then a no-op.
+  bool begin();
+  bool ready() const { return ready_; }
+
+  // Appends an entry and assigns entry.seq. Compacts first if the file is full.
+  bool append(Entry &entry);
+
+  // Marks an entry as delivered. Unknown/already acked seqs are ignored.
+  bool ack(uint32_t seq);
+
+  // Visits unacknowledged entries oldest first.
+  void forEachPending(Visitor visit, void* ctx);
+
+  // The last start without a matching end (a cycle cut short by a reboot).
+  bool openCycle(Entry &out) const;
+
+  const Stats &stats() const { return stats_; }
+
+ private:
+  struct Pending {
+    uint32_t seq;
+    uint32_t offset;  // record offset in the journal file
+  };
+
+  bool ready_ = false;
+  uint32_t nextSeq_ = 1;
+  uint32_t size_ = 0;
+  Pending pending_[BUILD_JOURNAL_MAX_PENDING];
+  uint16_t pendingCount_ = 0;
+  Pending staged_[BUILD_JOURNAL_MAX_PENDING];  // index being built by compact()
+  bool tornTail_ = false;  // recovery found a torn tail that compaction has not dropped yet
+  bool hasOpen_ = false;
+  Entry open_{};
+  Stats stats_{};
+
+  bool settleTmp();
+  bool recover();
+  bool compact();
+  bool writeRecord(fs::File &file, uint8_t type, uint32_t seq, const void* payload, uint16_t len);
+  bool readEntryAt(fs::File &file, uint32_t offset, Entry &out);
+  bool isPending(uint32_t seq) const;
+  void trackPending(uint32_t seq, uint32_t offset);
+  bool dropPending(uint32_t seq);
+  void trackCycle(const Entry &e);
+  static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t len);
+};
@@ -0,0 +1,138 @@
+// WarmStateStore.cpp
+
+#include "WarmStateStore.h"
+
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+// Size is part of the magic check: a firmware with a different layout never
+// reads a snapshot written by another.
+constexpr uint32_t kMagic = 0x57535431;  // "WST1"
+
+struct Slot {
+  uint32_t magic;
+  uint16_t size;
+  uint8_t chain;
+  uint8_t reserved;
+  uint32_t seq;
+  WarmStateStore::ControlState state;
+  uint32_t crc;  // over size..state; a write torn by a reset fails it
+};
+
+RTC_NOINIT_ATTR Slot gSlots[2];
+
+uint32_t slotCrc(const Slot &s) {
+  const uint8_t* begin = reinterpret_cast<const uint8_t*>(&s) + offsetof(Slot, size);
+  return esp_rom_crc32_le(0, begin, (uint32_t)(offsetof(Slot, crc) - offsetof(Slot, size)));
+}
+
+bool slotValid(const Slot &s) {
+  return s.magic == kMagic && s.size == sizeof(WarmStateStore::ControlState) && s.crc == slotCrc(s);
+}
+
+bool warmReset(esp_reset_reason_t reason) {
+  // RTC slow memory keeps its contents through these; a power-on leaves it
+  // undefined and the reset pin counts as a deliberate cold start.
+  switch (reason) {
+    case ESP_RST_SW:
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+    case ESP_RST_BROWNOUT:
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
+bool WarmStateStore::restore(ControlState &out) {
+#if BUILD_ENABLE_WARM_RESTART
+  have_ = false;
+  active_ = 1;
+  seq_ = 0;
+  chain_ = 0;
+  int best = -1;
+  if (warmReset(esp_reset_reason())) {
+    for (int i = 0; i < 2; i++) {
+      if (!slotValid(gSlots[i])) continue;
+      if (best < 0 || (int32_t)(gSlots[i].seq - gSlots[best].seq) > 0) best = i;
+    }
+  }
+  if (best < 0) {
+    // Whatever is left (e.g. from before a reset-pin restart) must never
+    // outrank the snapshots of this run.
+    gSlots[0].magic = 0;
+    gSlots[1].magic = 0;
+    return false;
+  }
+  const Slot &s = gSlots[best];
+  memcpy(&out, &s.state, sizeof(out));
+  active_ = (uint8_t)best;
+  seq_ = s.seq;
+  chain_ = s.chain < UINT8_MAX ? (uint8_t)(s.chain + 1) : UINT8_MAX;
+  // Store the new chain count right away: a reset before the next change
+  // still counts as one more restart in a row.
+  return write(out);
+#else
+  (void)out;
+  return false;
+#endif
+}
+
+bool WarmStateStore::save(const ControlState &state) {
+#if BUILD_ENABLE_WARM_RESTART
+  if (have_ && memcmp(&state, &last_, sizeof(state)) == 0) {
+    stats_.unchanged++;
+    return true;
+  }
+  return write(state);
+#else
+  (void)state;
+  return false;
+#endif
+}
+
+void WarmStateStore::markStable() {
+  if (chain_ == 0) return;
+  chain_ = 0;
+  if (have_) write(last_);
+}
+
+bool WarmStateStore::write(const ControlState &state) {
+  const uint8_t slot = (uint8_t)(active_ ^ 1);
+  Slot &s = gSlots[slot];
+  s.magic = kMagic;
+  s.size = sizeof(ControlState);
+  s.chain = chain_;
+  s.reserved = 0;
+  s.seq = seq_ + 1;
+  memcpy(&s.state, &state, sizeof(state));
+  s.crc = slotCrc(s);
+  memcpy(&last_, &state, sizeof(state));
+  have_ = true;
+  active_ = slot;
+  seq_++;
+  stats_.saves++;
+  return true;
+}
+
+const char* WarmStateStore::resetReason() const {
+  switch (esp_reset_reason()) {
+    case ESP_RST_POWERON: return "power-on";
+    case ESP_RST_EXT: return "reset pin";
+    case ESP_RST_SW: return "software";
+    case ESP_RST_PANIC: return "panic";
+    case ESP_RST_INT_WDT: return "interrupt watchdog";
+    case ESP_RST_TASK_WDT: return "task watchdog";
+    case ESP_RST_WDT: return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default: return "other";
+  }
+}
@@ -0,0 +1,65 @@
+// WarmStateStore.h
+// Control state snapshot in RTC slow memory (RTC_NOINIT), so a brownout,
+// watchdog or panic reset resumes where the device left off instead of
+// booting cold and waiting for the cloud.
+// - Two CRC-checked slots written alternately: a reset mid-write leaves the
+//   previous snapshot intact
+// - Only trusted after a warm reset; a power-on reset leaves RTC RAM undefined
+// - Counts back-to-back warm restores so a reset loop can be broken
+// - Single-task use (control task after begin()); not thread-safe
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "src/config/BuildConfig.h"
+#include "src/domain/Settings.h"
+
+class WarmStateStore {
+ public:
+  // Everything control needs to carry on. Compared bytewise to skip
+  // unchanged saves, so callers zero it before filling it in.
+  struct ControlState {
+    uint8_t relayOn = 0;
+    uint8_t haveTemp = 0;
+    uint8_t reserved[2] = {};
+    float filteredC = 0.0f;
+    int32_t scheduleYDay = -1;
+    uint32_t scheduleFiredMask = 0;
+    uint32_t openCycleId = 0;        // 0 = no open usage cycle
+    uint32_t openCycleStartSec = 0;  // SystemClock::now() at cycle start
+    SettingsSnapshot settings;
+  };
+
+  struct Stats {
+    uint32_t saves = 0;
+    uint32_t unchanged = 0;  // saves skipped because nothing changed
+  };
+
+  // Looks for a valid snapshot left by the previous run. Returns false after
+  // a cold boot, when disabled, or when neither slot passes its CRC.
+  bool restore(ControlState &out);
+
+  // Writes state to the inactive slot unless it matches the last one written.
+  bool save(const ControlState &state);
+
+  // Warm restores in a row without reaching markStable() (0 after a cold boot).
+  uint8_t restartChain() const { return chain_; }
+  // Ends the chain once the device has stayed up; rewrites the current snapshot.
+  void markStable();
+
+  // Reset reason of this boot, for logs.
+  const char* resetReason() const;
+
+  const Stats &stats() const { return stats_; }
+
+ private:
+  bool have_ = false;  // last_ holds what the active slot carries
+  uint8_t active_ = 1;  // slot written last; the next save goes to the other one
+  uint32_t seq_ = 0;
+  uint8_t chain_ = 0;
+  ControlState last_{};
+  Stats stats_{};
+
+  bool write(const ControlState &state);
+};
@@ -2,41 +2,69 @@
 
 #include "WifiManagerEsp32.h"
 
+#include <Preferences.h>
+#include <string.h>
+
+namespace {
+const char* kPrefsNamespace = "wifi";
+const char* kPrefsKey = "conn";
+constexpr uint32_t kCacheVersion = 1;
+}  // namespace
+
+// Wi-Fi events arrive on the system event task; there is one manager.
+static WifiManagerEsp32* s_wifi = nullptr;
+
 void WifiManagerEsp32::begin(const char* ssid, const char* pass) {
   ssid_ = ssid ? ssid : "";
   pass_ = pass ? pass : "";
 
   WiFi.mode(WIFI_STA);
   WiFi.setAutoReconnect(false);  // we'll manage retries
-  WiFi.persistent(false);
+  WiFi.persistent(false);        // the connect cache below is ours, not the driver's
+  s_wifi = this;
+  WiFi.onEvent(&WifiManagerEsp32::onWifiEvent);
 
-  state_ = STATE_CONNECTING;
   attemptCount_ = 0;
   nextAttemptMs_ = 0;
+  loadCache();
 
-  Logger::info("WiFi: starting connection to SSID '%s'", ssid_.c_str());
-  WiFi.begin(ssid_.c_str(), pass_.c_str());
+  Logger::info("WiFi: starting connection to SSID '%s' (cached ch=%u)", ssid_.c_str(),
+               haveCache_ ? (unsigned)cache_.channel : 0u);
+  connectStartMs_ = millisNow();
+  startAttempt();
 }
 
 bool WifiManagerEsp32::ensureConnected() {
   // Already connected?
   if (WiFi.status() == WL_CONNECTED) {
-    if (state_ != STATE_IDLE) {
-      Logger::info("WiFi: connected, IP=%s", WiFi.localIP().toString().c_str());
-      state_ = STATE_IDLE;  // steady state
-    }
+    if (state_ != STATE_IDLE) onConnected();  // steady state from here
     return true;
   }
 
   // Not connected: handle state machine
   switch (state_) {
+    case STATE_FAST_CONNECTING: {
+      // No WL_DISCONNECTED check here: it is also the status right after begin().
+      wl_status_t s = WiFi.status();
+      if (s == WL_CONNECT_FAILED || s == WL_NO_SSID_AVAIL ||
+          millisNow() - phaseStartMs_ >= BUILD_WIFI_FAST_TIMEOUT_MS) {
+        stats_.fastFailures++;
+        Logger::warn("WiFi: fast connect to cached AP failed (status=%d), scanning", static_cast<int>(s));
+        startScan();
+      }
+      break;
+    }
+    case STATE_SCANNING:
+      finishScan();
+      break;
     case STATE_CONNECTING: {
+      // As above, WL_DISCONNECTED is also the status while the attempt runs;
+      // only a definite failure or the phase timeout ends it.
       wl_status_t s = WiFi.status();
-      if (s == WL_CONNECTED) {
-        Logger::info("WiFi: connected, IP=%s", WiFi.localIP().toString().c_str());
-        state_ = STATE_IDLE;
-      } else if (s == WL_CONNECT_FAILED || s == WL_NO_SSID_AVAIL || s == WL_DISCONNECTED) {
-        Logger::warn("WiFi: connect status=%d, scheduling retry", static_cast<int>(s));
+      if (s == WL_CONNECT_FAILED || s == WL_NO_SSID_AVAIL ||
+          millisNow() - phaseStartMs_ >= BUILD_WIFI_CONNECT_TIMEOUT_MS) {
+        Logger::warn("WiFi: connect status=%d after %ums, scheduling retry", static_cast<int>(s),
+                     (unsigned)(millisNow() - phaseStartMs_));
         scheduleNextAttempt();
         state_ = STATE_WAIT_BACKOFF;
       }
@@ -46,18 +74,16 @@ bool WifiManagerEsp32::ensureConnected() {
       uint32_t now = millisNow();
       if (now >= nextAttemptMs_) {
         Logger::info("WiFi: retrying (attempt %lu) to '%s'", (unsigned long)attemptCount_ + 1, ssid_.c_str());
-        WiFi.disconnect(true);
-        delay(50);
-        WiFi.begin(ssid_.c_str(), pass_.c_str());
-        state_ = STATE_CONNECTING;
+        startAttempt();
       }
       break;
     }
     case STATE_IDLE: {
-      // Lost connection; go to retry with backoff
-      Logger::warn("WiFi: lost connection, scheduling retry");
-      scheduleNextAttempt();
-      state_ = STATE_WAIT_BACKOFF;
+      // Lost connection: the AP is most likely still where it was, so try
+      // the cached BSSID/channel right away; backoff starts if that fails.
+      Logger::warn("WiFi: lost connection, reconnecting");
+      connectStartMs_ = millisNow();
+      startAttempt();
       break;
     }
   }
@@ -79,6 +105,171 @@ IPAddress WifiManagerEsp32::localIp() const {
   return WiFi.localIP();
 }
 
+void WifiManagerEsp32::startAttempt() {
+  scanMs_ = 0;
+  if (!startFastConnect()) startScan();
+}
+
+bool WifiManagerEsp32::startFastConnect() {
+#if BUILD_WIFI_FAST_CONNECT
+  if (!haveCache_) return false;
+  applyStaticIp(true);
+  startConnect(cache_.bssid, cache_.channel);
+  state_ = STATE_FAST_CONNECTING;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void WifiManagerEsp32::startScan() {
+  applyStaticIp(false);
+  WiFi.disconnect();  // a directed attempt may still be pending
+  phaseStartMs_ = millisNow();
+  if (WiFi.scanNetworks(true /* async */, false, false, BUILD_WIFI_SCAN_MS_PER_CHAN) == WIFI_SCAN_FAILED) {
+    // Let the driver find the AP on its own.
+    startConnect(nullptr, 0);
+    state_ = STATE_CONNECTING;
+    return;
+  }
+  state_ = STATE_SCANNING;
+}
+
+void WifiManagerEsp32::finishScan() {
+  const int16_t n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return;
+  scanMs_ = millisNow() - phaseStartMs_;
+  // Strongest AP with our SSID; none seen (hidden SSID, out of range) leaves
+  // the search to the driver.
+  int16_t best = -1;
+  for (int16_t i = 0; i < n; i++) {
+    if (WiFi.SSID(i) != ssid_) continue;
+    if (best < 0 || WiFi.RSSI(i) > WiFi.RSSI(best)) best = i;
+  }
+  uint8_t bssid[6];
+  int32_t channel = 0;
+  if (best >= 0) {
+    memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+    channel = WiFi.channel(best);
+  }
+  Logger::info("WiFi: scan took %ums, %d APs, target %s (ch=%d)", (unsigned)scanMs_, (int)n,
+               best >= 0 ? "found" : "not seen", (int)channel);
+  WiFi.scanDelete();
+  startConnect(best >= 0 ? bssid : nullptr, channel);
+  state_ = STATE_CONNECTING;
+}
+
+void WifiManagerEsp32::startConnect(const uint8_t* bssid, int32_t channel) {
+  associatedMs_.store(0, std::memory_order_relaxed);
+  gotIpMs_.store(0, std::memory_order_relaxed);
+  phaseStartMs_ = millisNow();
+  WiFi.begin(ssid_.c_str(), pass_.c_str(), channel, bssid, true);
+}
+
+void WifiManagerEsp32::applyStaticIp(bool fastPath) {
+  // A configured static address always applies. The cached lease is only
+  // reused on the fast path (same AP); a scan falls back to DHCP.
+  IPAddress ip, gateway, subnet, dns;
+  bool useStatic = false;
+  const char* staticIp = BUILD_WIFI_STATIC_IP;
+  if (staticIp[0] && ip.fromString(staticIp) && gateway.fromString(BUILD_WIFI_STATIC_GATEWAY) &&
+      subnet.fromString(BUILD_WIFI_STATIC_SUBNET)) {
+    if (!dns.fromString(BUILD_WIFI_STATIC_DNS)) dns = gateway;
+    useStatic = true;
+  } else if (BUILD_WIFI_REUSE_LEASE && fastPath && cache_.ip && cache_.gateway) {
+    ip = IPAddress(cache_.ip);
+    gateway = IPAddress(cache_.gateway);
+    subnet = IPAddress(cache_.subnet);
+    dns = IPAddress(cache_.dns ? cache_.dns : cache_.gateway);
+    useStatic = true;
+  }
+  if (useStatic) {
+    WiFi.config(ip, gateway, subnet, dns);
+  } else if (staticApplied_) {
+    const IPAddress none((uint32_t)0);
+    WiFi.config(none, none, none);  // back to DHCP
+  }
+  staticApplied_ = useStatic;
+}
+
+void WifiManagerEsp32::onConnected() {
+  const uint32_t now = millisNow();
+  const uint32_t assoc = associatedMs_.load(std::memory_order_acquire);
+  const uint32_t gotIp = gotIpMs_.load(std::memory_order_acquire);
+  timings_.fast = state_ == STATE_FAST_CONNECTING;
+  timings_.scanMs = timings_.fast ? 0 : scanMs_;
+  timings_.authMs = assoc ? assoc - phaseStartMs_ : now - phaseStartMs_;
+  timings_.dhcpMs = assoc && gotIp ? gotIp - assoc : 0;
+  timings_.totalMs = now - connectStartMs_;
+  if (timings_.fast) stats_.fastConnects++;
+  else stats_.scanConnects++;
+  attemptCount_ = 0;
+  state_ = STATE_IDLE;
+  Logger::info("WiFi: connected (%s) in %ums: scan=%u auth=%u dhcp=%u, IP=%s ch=%d",
+               timings_.fast ? "fast" : "scan", (unsigned)timings_.totalMs, (unsigned)timings_.scanMs,
+               (unsigned)timings_.authMs, (unsigned)timings_.dhcpMs, WiFi.localIP().toString().c_str(),
+               (int)WiFi.channel());
+  saveCache();
+}
+
+void WifiManagerEsp32::loadCache() {
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, true)) return;  // nothing stored yet
+  Cache c;
+  const size_t n = prefs.getBytes(kPrefsKey, &c, sizeof(c));
+  prefs.end();
+  haveCache_ = n == sizeof(c) && c.version == kCacheVersion && c.ssidHash == hashSsid(ssid_) && c.channel;
+  if (haveCache_) cache_ = c;
+}
+
+void WifiManagerEsp32::saveCache() {
+  const uint8_t* bssid = WiFi.BSSID();
+  if (!bssid) return;
+  Cache c;
+  c.version = kCacheVersion;
+  c.ssidHash = hashSsid(ssid_);
+  memcpy(c.bssid, bssid, sizeof(c.bssid));
+  c.channel = (uint8_t)WiFi.channel();
+  c.ip = (uint32_t)WiFi.localIP();
+  c.gateway = (uint32_t)WiFi.gatewayIP();
+  c.subnet = (uint32_t)WiFi.subnetMask();
+  c.dns = (uint32_t)WiFi.dnsIP(0);
+  // Flash writes only when something changed (reconnects to the same AP are free).
+  if (haveCache_ && memcmp(&c, &cache_, sizeof(c)) == 0) return;
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) return;
+  const bool ok = prefs.putBytes(kPrefsKey, &c, sizeof(c)) == sizeof(c);
+  prefs.end();
+  if (!ok) {
+    Logger::warn("WiFi: failed to store connect cache");
+    return;
+  }
+  cache_ = c;
+  haveCache_ = true;
+  stats_.cacheWrites++;
+}
+
+uint32_t WifiManagerEsp32::hashSsid(const String &ssid) {
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for (unsigned i = 0; i < ssid.length(); i++) {
+    h ^= (uint8_t)ssid[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void WifiManagerEsp32::onWifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  (void)info;
+  WifiManagerEsp32* self = s_wifi;
+  if (!self) return;
+  if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+    self->associatedMs_.store(millis(), std::memory_order_release);
+  } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+    self->gotIpMs_.store(millis(), std::memory_order_release);
+  }
+}
+
 void WifiManagerEsp32::scheduleNextAttempt() {
   // Exponential backoff with jitter: delay = min(max, base * 2^attempt) +/- jitter
   uint32_t expDelay = kBaseDelayMs;
@@ -98,5 +289,3 @@ void WifiManagerEsp32::scheduleNextAttempt() {
   attemptCount_++;
   Logger::debug("WiFi: backoff %ld ms (attempt %lu)", (long)delayWithJitter, (unsigned long)attemptCount_);
 }
-
-
@@ -1,13 +1,19 @@
 // WifiManagerEsp32.h
 // Thin, robust wrapper around Arduino WiFi for ESP32.
 // - Non-blocking connection with exponential backoff and jitter
+// - Fast connect: the last good BSSID/channel (kept in NVS) are tried first
+//   with a directed connect; on failure an async scan picks the strongest AP
+// - Optional static IP (BUILD_WIFI_STATIC_IP) or reuse of the cached lease
+// - Per-phase connect timings (scan, auth, DHCP)
 // - Simple API for ensuring connectivity and retrieving signal strength
 
 #pragma once
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <atomic>
 
+#include "src/config/BuildConfig.h"
 #include "src/infrastructure/Logger.h"
 
 class WifiManagerEsp32 {
@@ -29,18 +35,63 @@ class WifiManagerEsp32 {
   // Returns the local IP address when connected; otherwise 0.0.0.0
   IPAddress localIp() const;
 
+  // Phases of the last successful connect (ms). scanMs is 0 on the fast path,
+  // dhcpMs is 0 with a static address.
+  struct Timings {
+    uint32_t scanMs = 0;
+    uint32_t authMs = 0;   // connect request -> associated
+    uint32_t dhcpMs = 0;   // associated -> IP
+    uint32_t totalMs = 0;  // first attempt -> IP, retries included
+    bool fast = false;     // connected via the cached BSSID/channel
+  };
+  const Timings &lastTimings() const { return timings_; }
+
+  struct Stats {
+    uint32_t fastConnects = 0;
+    uint32_t fastFailures = 0;   // fell back to a scan
+    uint32_t scanConnects = 0;
+    uint32_t cacheWrites = 0;    // NVS updates (only when BSSID/channel/lease change)
+  };
+  const Stats &stats() const { return stats_; }
+
  private:
   enum ConnectState {
     STATE_IDLE,
+    STATE_FAST_CONNECTING,
+    STATE_SCANNING,
     STATE_CONNECTING,
     STATE_WAIT_BACKOFF,
   };
 
+  // Last good association, persisted in NVS.
+  struct Cache {
+    uint32_t version = 0;
+    uint32_t ssidHash = 0;  // cache only applies to the SSID it was made for
+    uint8_t bssid[6] = {};
+    uint8_t channel = 0;
+    uint8_t reserved = 0;   // keeps the record free of padding (compared bytewise)
+    uint32_t ip = 0;
+    uint32_t gateway = 0;
+    uint32_t subnet = 0;
+    uint32_t dns = 0;
+  };
+
   String ssid_;
   String pass_;
   ConnectState state_ = STATE_IDLE;
   uint32_t attemptCount_ = 0;
   uint32_t nextAttemptMs_ = 0;
+  Cache cache_{};
+  bool haveCache_ = false;
+  bool staticApplied_ = false;
+  uint32_t connectStartMs_ = 0;  // first attempt of this connect sequence
+  uint32_t phaseStartMs_ = 0;    // start of the current scan/connect phase
+  uint32_t scanMs_ = 0;
+  Timings timings_{};
+  Stats stats_{};
+  // Set from the Wi-Fi event task.
+  std::atomic<uint32_t> associatedMs_{0};
+  std::atomic<uint32_t> gotIpMs_{0};
 
   // Backoff configuration
   static constexpr uint32_t kBaseDelayMs = 1000;        // 1s
@@ -49,6 +100,16 @@ class WifiManagerEsp32 {
 
   void scheduleNextAttempt();
   uint32_t millisNow() const { return millis(); }
-};
-
 
+  void startAttempt();
+  bool startFastConnect();
+  void startScan();
+  void finishScan();
+  void startConnect(const uint8_t* bssid, int32_t channel);
+  void applyStaticIp(bool fastPath);
+  void onConnected();
+  void loadCache();
+  void saveCache();
+  static uint32_t hashSsid(const String &ssid);
+  static void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info);
+};
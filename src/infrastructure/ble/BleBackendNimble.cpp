@@ -112,14 +112,79 @@ bool BleBackendNimble::ensureCustomTime(const String &defaultHhmm, String &outHh
   return true;
 }
 
+bool BleBackendNimble::fetchSettingsRevision(uint32_t &outRevision) {
+  outRevision = settingsRevision_.load(std::memory_order_relaxed);
+  return true;
+}
+
 bool BleBackendNimble::setStringPath(const String &/*path*/, const String &/*value*/) {
   // Usage and misc string paths can be implemented later; return true to avoid failing callers
   return true;
 }
 
-bool BleBackendNimble::setIntPath(const String &/*path*/, int value) {
+bool BleBackendNimble::setIntPath(const String &path, int value) {
+  // Only the daily total has a characteristic; per-cycle fields are cloud-only.
+  if (!path.endsWith("totalDurationSec")) return true;
   if (value < 0) value = 0;
+  usageTotalPath_ = path;
   usageTotalTodaySec_ = static_cast<uint32_t>(value);
+  notifyUsageTotal();
+  return true;
+}
+
+bool BleBackendNimble::incrementIntPath(const String &path, int delta) {
+  if (path != usageTotalPath_) {
+    usageTotalPath_ = path;
+    usageTotalTodaySec_ = 0;
+  }
+  const int64_t next = (int64_t)usageTotalTodaySec_ + delta;
+  usageTotalTodaySec_ = next < 0 ? 0u : (uint32_t)next;
+  notifyUsageTotal();
+  return true;
+}
+
+bool BleBackendNimble::takeHistoryRequest(uint32_t &fromSec, uint32_t &toSec) {
+  if (!historyRequested_.exchange(false, std::memory_order_acquire)) return false;
+  fromSec = historyFromSec_.load(std::memory_order_relaxed);
+  toSec = historyToSec_.load(std::memory_order_relaxed);
+  return true;
+}
+
+uint16_t BleBackendNimble::streamHistory(CompressedHistory::Cursor &cursor, uint16_t maxPoints) {
+  if (!active_) return 0;
+  uint16_t sent = 0;
+#if BUILD_ENABLE_BLE
+  if (!cHistory_) return 0;
+  auto *c = (NimBLECharacteristic*)cHistory_;
+  BleUuids::HistoryRecord chunk[BleUuids::HISTORY_RECORDS_PER_NOTIFY];
+  CompressedHistory::Point p;
+  while (sent < maxPoints) {
+    uint8_t n = 0;
+    while (n < BleUuids::HISTORY_RECORDS_PER_NOTIFY && sent + n < maxPoints && cursor.next(p)) {
+      chunk[n].epochSec = p.epochSec;
+      chunk[n].tempC16 = (int16_t)lroundf(p.tempC * CompressedHistory::kScale);
+      chunk[n].relayOn = p.relayOn ? 1 : 0;
+      chunk[n].reserved = 0;
+      n++;
+    }
+    if (n == 0) break;
+    c->setValue(reinterpret_cast<uint8_t*>(chunk), n * sizeof(BleUuids::HistoryRecord));
+    c->notify();
+    sent += n;
+  }
+  if (cursor.done()) {
+    static const uint8_t kEnd = 0;
+    c->setValue(&kEnd, 0);  // zero-length: end of range
+    c->notify();
+  }
+#else
+  (void)cursor;
+  (void)maxPoints;
+#endif
+  return sent;
+}
+
+void BleBackendNimble::notifyUsageTotal() {
 #if BUILD_ENABLE_BLE
   if (cUsageTotal_) {
     uint32_t v = usageTotalTodaySec_;
@@ -127,7 +192,6 @@ bool BleBackendNimble::setIntPath(const String &/*path*/, int value) {
     ((NimBLECharacteristic*)cUsageTotal_)->notify();
   }
 #endif
-  return true;
 }
 
 bool BleBackendNimble::getIntPath(const String &/*path*/, int &outValue) {
@@ -178,20 +242,32 @@ class BleBackendNimble::CharWriteCb : public NimBLECharacteristicCallbacks {
       auto val = c->getValue();
       float f = 0.0f; memcpy(&f, val.data(), std::min((size_t)sizeof(float), (size_t)val.length()));
       owner_->settings_.maxTempC = f;
+      owner_->settingsRevision_++;
     } else if (uuid == BleUuids::CHAR_HYSTERESISC) {
       auto val = c->getValue();
       float f = 0.0f; memcpy(&f, val.data(), std::min((size_t)sizeof(float), (size_t)val.length()));
       owner_->hysteresisC_ = f;
+      owner_->settingsRevision_++;
     } else if (uuid == BleUuids::CHAR_TIMERS_BITMASK) {
       auto val = c->getValue();
       uint8_t m = 0; if (val.length() > 0) m = (uint8_t)((const uint8_t*)val.data())[0];
       owner_->setTimersBitmask(m);
+      owner_->settingsRevision_++;
     } else if (uuid == BleUuids::CHAR_CUSTOMTIME) {
       auto val = c->getValue();
       std::string s((const char*)val.data(), val.length());
       String hhmm = String(s.c_str());
       hhmm.trim();
       if (hhmm.length() == 5) owner_->settings_.customTime = hhmm; else owner_->settings_.customTime.remove(0);
+      owner_->settingsRevision_++;
+    } else if (uuid == BleUuids::CHAR_HISTORY) {
+      auto val = c->getValue();
+      uint32_t range[2] = {0, 0xFFFFFFFFu};
+      memcpy(range, val.data(), std::min(sizeof(range), (size_t)val.length()));
+      owner_->historyFromSec_.store(range[0], std::memory_order_relaxed);
+      owner_->historyToSec_.store(range[1], std::memory_order_relaxed);
+      owner_->historyRequested_.store(true, std::memory_order_release);
+      return;  // nothing to mirror
     } else if (uuid == BleUuids::CHAR_TIMESYNC_EPOCH) {
       auto val = c->getValue();
       uint32_t epoch = 0; memcpy(&epoch, val.data(), std::min((size_t)sizeof(uint32_t), (size_t)val.length()));
@@ -219,6 +295,7 @@ void BleBackendNimble::initGatt() {
   cDate_ = svc->createCharacteristic(BleUuids::CHAR_LASTUPDATEDATE, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
   cTimeSync_ = svc->createCharacteristic(BleUuids::CHAR_TIMESYNC_EPOCH, NIMBLE_PROPERTY::WRITE);
   cUsageTotal_ = svc->createCharacteristic(BleUuids::CHAR_USAGE_TOTAL_TODAY, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+  cHistory_ = svc->createCharacteristic(BleUuids::CHAR_HISTORY, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY);
 
   auto *cb = new CharWriteCb(this);
   ((NimBLECharacteristic*)cCmd_)->setCallbacks(cb);
@@ -227,6 +304,7 @@ void BleBackendNimble::initGatt() {
   ((NimBLECharacteristic*)cTimers_)->setCallbacks(cb);
   ((NimBLECharacteristic*)cCustom_)->setCallbacks(cb);
   ((NimBLECharacteristic*)cTimeSync_)->setCallbacks(cb);
+  ((NimBLECharacteristic*)cHistory_)->setCallbacks(cb);
 
   svc->start();
 }
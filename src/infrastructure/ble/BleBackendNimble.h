@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 
 #include "src/config/BuildConfig.h"
 #include "src/infrastructure/RemoteBackend.h"
@@ -27,10 +28,19 @@ class BleBackendNimble : public RemoteBackend {
   bool ensureHysteresis(float defaultCelsius, float &outCelsius) override;
   bool ensureTimerFlag(const String &key, bool defaultEnabled, bool &outEnabled) override;
   bool ensureCustomTime(const String &defaultHhmm, String &outHhmm) override;
+  // Bumped on every settings GATT write.
+  bool fetchSettingsRevision(uint32_t &outRevision) override;
 
   bool setStringPath(const String &/*path*/, const String &/*value*/) override;
-  bool setIntPath(const String &/*path*/, int /*value*/) override;
+  bool setIntPath(const String &path, int value) override;
   bool getIntPath(const String &/*path*/, int &/*outValue*/) override;
+  // Local accumulator for the daily usage total; a new day path restarts it.
+  bool incrementIntPath(const String &path, int delta) override;
+
+  // History range requested over CHAR_HISTORY since the last call, if any.
+  bool takeHistoryRequest(uint32_t &fromSec, uint32_t &toSec);
+  // Notifies points on CHAR_HISTORY; sends the end marker once the cursor is done.
+  uint16_t streamHistory(CompressedHistory::Cursor &cursor, uint16_t maxPoints) override;
 
  private:
   // Simple in-RAM settings cache (no local flash/RTC persistence)
@@ -49,11 +59,18 @@ class BleBackendNimble : public RemoteBackend {
   uint8_t getTimersBitmask() const;
 
   BleSettings settings_{};
+  std::atomic<uint32_t> settingsRevision_{1};  // written from the NimBLE host task
   bool active_ = false;
   RelayCallback relayCb_ = nullptr;
   void* relayCtx_ = nullptr;
   // In-RAM daily usage total in seconds, mirrored to CHAR_USAGE_TOTAL_TODAY.
   uint32_t usageTotalTodaySec_ = 0;
+  String usageTotalPath_;  // day path the accumulator belongs to
+  void notifyUsageTotal();
+  // History request from the NimBLE host task
+  std::atomic<bool> historyRequested_{false};
+  std::atomic<uint32_t> historyFromSec_{0};
+  std::atomic<uint32_t> historyToSec_{0};
 
   // Local-only hysteresis until persisted support is added
   float hysteresisC_ = 2.0f;
@@ -81,6 +98,7 @@ class BleBackendNimble : public RemoteBackend {
   void *cDate_ = nullptr;
   void *cTimeSync_ = nullptr;
   void *cUsageTotal_ = nullptr;
+  void *cHistory_ = nullptr;
 #endif
 };
 
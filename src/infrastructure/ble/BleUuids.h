@@ -21,6 +21,19 @@ static const char* const CHAR_LASTUPDATETIME   = "8b8a0008-7c9c-4a3f-b3a6-02b8a0
 static const char* const CHAR_LASTUPDATEDATE   = "8b8a0009-7c9c-4a3f-b3a6-02b8a0f0d101"; // string notify/read
 static const char* const CHAR_TIMESYNC_EPOCH   = "8b8a000A-7c9c-4a3f-b3a6-02b8a0f0d101"; // uint32 write
 static const char* const CHAR_USAGE_TOTAL_TODAY= "8b8a000B-7c9c-4a3f-b3a6-02b8a0f0d101"; // uint32 read/notify (optional)
+// History: write {uint32 fromSec, uint32 toSec} to request a range; points are
+// notified as packed HistoryRecords, a zero-length notification ends the range.
+static const char* const CHAR_HISTORY          = "8b8a000C-7c9c-4a3f-b3a6-02b8a0f0d101"; // write/notify
+
+// One history point on the wire (little-endian, 8 bytes).
+struct __attribute__((packed)) HistoryRecord {
+  uint32_t epochSec;
+  int16_t tempC16;  // temperature in 1/16 C
+  uint8_t relayOn;
+  uint8_t reserved;
+};
+// Records per notification: fits the default 20-byte ATT payload.
+static const uint8_t HISTORY_RECORDS_PER_NOTIFY = 2;
 
 // Timers bit positions: 0=04:00, 1=06:00, 2=08:00, 3=16:00, 4=18:00, 5=CUSTOM
 inline uint8_t packTimers(bool t0400, bool t0600, bool t0800, bool t1600, bool t1800, bool custom) {
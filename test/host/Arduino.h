@@ -0,0 +1,34 @@
+// Arduino.h (host test stand-in)
+// Just enough of the Arduino core for the host tests: integer types, a
+// Serial that prints to stdout, a millis() clock the test advances by hand
+// and IPAddress.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct HostSerial {
+  void print(char c) { putchar(c); }
+  void print(const char* s) { fputs(s, stdout); }
+  void println(const char* s) { puts(s); }
+};
+extern HostSerial Serial;
+
+// Host clock: tests set or advance it; nothing else moves it.
+inline uint32_t hostMillis = 0;
+inline uint32_t millis() { return hostMillis; }
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : b_{a, b, c, d} {}
+  bool operator==(const IPAddress &o) const { return memcmp(b_, o.b_, sizeof(b_)) == 0; }
+  bool operator!=(const IPAddress &o) const { return !(*this == o); }
+  uint8_t operator[](int i) const { return b_[i]; }
+
+ private:
+  uint8_t b_[4] = {};
+};
@@ -0,0 +1,194 @@
+// CachingSecureClientTest.cpp
+// Host-side test of CachingSecureClient against a fake resolver and TLS
+// transport: DNS cache hits and TTL expiry, re-resolution when the cached
+// address stops answering, the cache shared by the request and stream
+// clients, and the handshake/reuse counters. Build and run from the repo root:
+//   g++ -std=gnu++17 -I. -Itest/host test/host/CachingSecureClientTest.cpp
+//       src/infrastructure/CachingSecureClient.cpp src/infrastructure/Logger.cpp
+//       -o /tmp/tls_test && /tmp/tls_test
+
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+
+#include "src/infrastructure/CachingSecureClient.h"
+
+HostSerial Serial;
+WiFiClass WiFi;
+FakeTls gTls;
+
+namespace {
+
+const uint16_t kPort = 443;
+const IPAddress kIpA(10, 0, 0, 1);
+const IPAddress kIpB(10, 0, 0, 2);
+
+int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);            \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+// The DNS cache is shared by every instance: each test uses its own host
+// name and starts well past the previous test's TTL.
+void reset() {
+  hostMillis += 2 * BUILD_RTDB_DNS_TTL_MS;
+  WiFi.dns.clear();
+  WiFi.lookups = 0;
+  WiFi.lookupMs = 0;
+  gTls = FakeTls();
+}
+
+// One lookup per TTL; connects in between use the cached address, with the
+// host name still sent as SNI.
+void testCacheHitsAndExpiry() {
+  reset();
+  const char* host = "a.example.firebaseio.com";
+  WiFi.dns[host] = kIpA;
+  WiFi.lookupMs = 40;
+  gTls.reachable = {kIpA};
+  CachingSecureClient c;
+  CHECK(c.connect(host, kPort) == 1);
+  CHECK(WiFi.lookups == 1);
+  CHECK(gTls.lastIp == kIpA && gTls.lastSni == host);
+  c.stop();
+  hostMillis += BUILD_RTDB_DNS_TTL_MS - 1000;
+  CHECK(c.connect(host, kPort) == 1);
+  CHECK(WiFi.lookups == 1);
+  c.stop();
+  hostMillis += 1000;  // TTL reached
+  CHECK(c.connect(host, kPort) == 1);
+  CHECK(WiFi.lookups == 2);
+  CHECK(c.stats().dnsLookups == 2);
+  CHECK(c.stats().dnsHits == 1);
+  CHECK(c.stats().handshakes == 3);
+}
+
+// The cached address stops answering: the client resolves again and retries
+// once on the new address, without counting a failure.
+void testMovedHost() {
+  reset();
+  const char* host = "b.example.firebaseio.com";
+  WiFi.dns[host] = kIpA;
+  gTls.reachable = {kIpA};
+  CachingSecureClient c;
+  CHECK(c.connect(host, kPort) == 1);
+  c.stop();
+  WiFi.dns[host] = kIpB;
+  gTls.reachable = {kIpB};
+  WiFi.lookupMs = 200;
+  gTls.handshakeMs = 700;
+  hostMillis += 1000;
+  CHECK(c.connect(host, kPort) == 1);
+  CHECK(gTls.connects == 3);
+  CHECK(gTls.lastIp == kIpB);
+  CHECK(WiFi.lookups == 2);
+  CHECK(c.stats().connectFailures == 0);
+  CHECK(c.stats().lastHandshakeMs == 1400);  // both attempts, not the lookup between them
+  c.stop();
+  // The new address is cached.
+  CHECK(c.connect(host, kPort) == 1);
+  CHECK(WiFi.lookups == 2);
+
+  // Unreachable on both: one retry, then a single failure.
+  c.stop();
+  gTls.reachable.clear();
+  CHECK(c.connect(host, kPort) == 0);
+  CHECK(gTls.connects == 6);
+  CHECK(WiFi.lookups == 3);
+  CHECK(c.stats().connectFailures == 1);
+}
+
+// Lookup failures are counted as connect failures and never cached.
+void testLookupFailure() {
+  reset();
+  const char* host = "c.example.firebaseio.com";
+  CachingSecureClient c;
+  CHECK(c.connect(host, kPort) == 0);
+  CHECK(gTls.connects == 0);
+  CHECK(c.stats().connectFailures == 1);
+  WiFi.dns[host] = kIpA;
+  gTls.reachable = {kIpA};
+  CHECK(c.connect(host, kPort) == 1);
+  CHECK(WiFi.lookups == 2);
+}
+
+// The request client and the stream client share one cached answer; a
+// different host replaces it.
+void testSharedCache() {
+  reset();
+  const char* host = "d.example.firebaseio.com";
+  const char* other = "e.example.firebaseio.com";
+  WiFi.dns[host] = kIpA;
+  WiFi.dns[other] = kIpB;
+  gTls.reachable = {kIpA, kIpB};
+  CachingSecureClient requests, stream;
+  CHECK(requests.connect(host, kPort) == 1);
+  CHECK(stream.connect(host, kPort) == 1);
+  CHECK(WiFi.lookups == 1);
+  CHECK(stream.stats().dnsHits == 1 && stream.stats().dnsLookups == 0);
+  stream.stop();
+  CHECK(stream.connect(other, kPort) == 1);
+  CHECK(WiFi.lookups == 2);
+  requests.stop();
+  CHECK(requests.connect(host, kPort) == 1);
+  CHECK(WiFi.lookups == 3);
+}
+
+// Host names too long for the cache are looked up every time.
+void testLongHost() {
+  reset();
+  const std::string host = std::string(70, 'x') + ".firebaseio.com";
+  WiFi.dns[host] = kIpA;
+  gTls.reachable = {kIpA};
+  CachingSecureClient c;
+  CHECK(c.connect(host.c_str(), kPort) == 1);
+  c.stop();
+  CHECK(c.connect(host.c_str(), kPort) == 1);
+  CHECK(WiFi.lookups == 2);
+  CHECK(c.stats().dnsHits == 0);
+}
+
+// Handshake timings exclude DNS; requests on an open connection count as
+// reused, requests that will trigger a connect do not.
+void testHandshakeCounters() {
+  reset();
+  const char* host = "f.example.firebaseio.com";
+  WiFi.dns[host] = kIpA;
+  WiFi.lookupMs = 500;
+  gTls.reachable = {kIpA};
+  CachingSecureClient c;
+  c.noteRequest();  // no connection yet: the library connects first
+  gTls.handshakeMs = 900;
+  CHECK(c.connect(host, kPort) == 1);
+  c.noteRequest();
+  c.noteRequest();
+  c.stop();
+  c.noteRequest();
+  gTls.handshakeMs = 300;
+  CHECK(c.connect(host, kPort) == 1);
+  c.noteRequest();
+  const CachingSecureClient::Stats &st = c.stats();
+  CHECK(st.handshakes == 2);
+  CHECK(st.reused == 3);
+  CHECK(st.lastHandshakeMs == 300);
+  CHECK(st.maxHandshakeMs == 900);
+  CHECK(st.totalHandshakeMs == 1200);
+  CHECK(st.connectFailures == 0);
+}
+
+}  // namespace
+
+int main() {
+  testCacheHitsAndExpiry();
+  testMovedHost();
+  testLookupFailure();
+  testSharedCache();
+  testLongHost();
+  testHandshakeCounters();
+  printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
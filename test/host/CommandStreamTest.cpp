@@ -0,0 +1,221 @@
+// CommandStreamTest.cpp
+// Host-side test of the RTDB command stream lifecycle (CommandStream) against
+// a fake SSE transport: first subscribe, value resync after reconnects,
+// silence and cancel handling, resubscribe backoff, and that a subscription is
+// always stopped before the next one starts. Build and run from the repo root:
+//   g++ -std=gnu++17 -I. -Itest/host test/host/CommandStreamTest.cpp
+//       src/infrastructure/CommandStream.cpp src/infrastructure/Logger.cpp
+//       -o /tmp/stream_test && /tmp/stream_test
+
+#include <Arduino.h>
+
+#include "src/infrastructure/CommandStream.h"
+
+HostSerial Serial;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);            \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+// SSE endpoint for the command node. A subscription that is open when the
+// node changes receives the put; a new one starts with a put of the whole
+// node (what RTDB sends first on every stream).
+struct FakeTransport {
+  CommandStream* stream = nullptr;
+  bool node = false;
+  int open = 0;          // subscriptions started and not stopped
+  int maxOpen = 0;
+  int subscribes = 0;
+  int unsubscribes = 0;
+  bool reachable = true;  // false: subscriptions are accepted but never answer
+  uint32_t nowMs = 0;
+
+  static void subscribe(void* ctx) {
+    auto *t = static_cast<FakeTransport*>(ctx);
+    t->subscribes++;
+    t->open++;
+    if (t->open > t->maxOpen) t->maxOpen = t->open;
+    if (t->reachable) t->stream->onValue(t->node, t->nowMs);  // initial put
+  }
+  static void unsubscribe(void* ctx) {
+    auto *t = static_cast<FakeTransport*>(ctx);
+    t->unsubscribes++;
+    t->open--;
+  }
+
+  void write(bool value) {
+    node = value;
+    if (open && reachable) stream->onValue(value, nowMs);
+  }
+  void keepAlive() {
+    if (open && reachable) stream->onKeepAlive(nowMs);
+  }
+};
+
+CommandStream::Config config() {
+  CommandStream::Config c;
+  c.timeoutMs = 70000;
+  c.retryMs = 2000;
+  c.maxRetryMs = 60000;
+  return c;
+}
+
+void setup(CommandStream &s, FakeTransport &t) {
+  t.stream = &s;
+  s.configure(config(), &FakeTransport::subscribe, &FakeTransport::unsubscribe, &t);
+}
+
+// Advances the clock in loop()-sized steps, ticking the stream each time.
+void run(CommandStream &s, FakeTransport &t, uint32_t forMs, bool ready = true, uint32_t stepMs = 500) {
+  const uint32_t end = t.nowMs + forMs;
+  while ((int32_t)(end - t.nowMs) > 0) {
+    t.nowMs += stepMs;
+    s.tick(t.nowMs, ready);
+  }
+}
+
+// Nothing is subscribed before the transport is ready; the first subscribe
+// delivers the current value and makes the stream alive.
+void testFirstSubscribe() {
+  CommandStream s;
+  FakeTransport t;
+  setup(s, t);
+  t.node = true;
+  run(s, t, 5000, false);
+  CHECK(t.subscribes == 0);
+  CHECK(!s.alive());
+  run(s, t, 500);
+  CHECK(t.subscribes == 1);
+  CHECK(s.alive());
+  bool v = false;
+  CHECK(s.takeValue(v) && v);
+  CHECK(!s.takeValue(v));
+  t.write(false);
+  CHECK(s.takeValue(v) && !v);
+}
+
+// Keep-alives hold the stream open; silence past the timeout stops the dead
+// subscription before a new one starts, and the new one resyncs a value
+// written while the stream was deaf.
+void testSilenceResync() {
+  CommandStream s;
+  FakeTransport t;
+  setup(s, t);
+  run(s, t, 500);
+  bool v = true;
+  CHECK(s.takeValue(v) && !v);
+  for (int i = 0; i < 10; i++) {
+    run(s, t, 30000);
+    t.keepAlive();
+  }
+  CHECK(t.subscribes == 1);
+  CHECK(s.healthy(t.nowMs));
+
+  t.reachable = false;  // half-open TCP: nothing arrives any more
+  t.write(true);
+  CHECK(!s.takeValue(v));
+  run(s, t, 70000);
+  CHECK(s.alive());
+  run(s, t, 1000);
+  CHECK(s.stats().timeouts == 1);
+  CHECK(t.unsubscribes == 1);
+  CHECK(t.subscribes == 2);
+  CHECK(t.maxOpen == 1);
+  CHECK(!s.alive());  // the client polls meanwhile
+
+  // The network is back, but the second subscription went out while it was
+  // not; it times out too and the third one resyncs the value.
+  t.reachable = true;
+  run(s, t, 71000);
+  CHECK(t.subscribes == 3);
+  CHECK(t.unsubscribes == 2);
+  CHECK(s.alive());
+  CHECK(s.takeValue(v) && v);
+  CHECK(t.maxOpen == 1);
+}
+
+// Errors and cancel drop the stream; resubscribes back off (doubling, capped)
+// until a healthy event resets the delay. cancel itself is no such proof.
+void testBackoff() {
+  CommandStream s;
+  FakeTransport t;
+  setup(s, t);
+  t.reachable = false;
+  run(s, t, 500);
+  CHECK(t.subscribes == 1);
+  uint32_t lastSubscribeMs = t.nowMs;
+  uint32_t expectGap = 2000;
+  for (int i = 0; i < 8; i++) {
+    s.onDrop();  // error from the library
+    while (t.subscribes == i + 1) run(s, t, 100, true, 100);
+    CHECK(t.nowMs - lastSubscribeMs == expectGap);
+    lastSubscribeMs = t.nowMs;
+    expectGap = expectGap * 2 > 60000 ? 60000 : expectGap * 2;
+  }
+  CHECK(s.stats().retryMs == 60000);
+  CHECK(t.unsubscribes == t.subscribes - 1);
+  CHECK(t.maxOpen == 1);
+
+  // cancel right after subscribing: still backing off.
+  s.onDrop();
+  run(s, t, 59000);
+  CHECK(t.subscribes == 9);
+  run(s, t, 1000);
+  CHECK(t.subscribes == 10);
+
+  // A healthy stream resets the delay for the next drop.
+  t.reachable = true;
+  t.keepAlive();
+  CHECK(s.alive());
+  CHECK(s.stats().retryMs == 2000);
+  run(s, t, 60000);
+  t.keepAlive();
+  s.onDrop();
+  run(s, t, 500);
+  CHECK(t.subscribes == 11);
+}
+
+// Events from a subscription already given up are ignored; stop() releases
+// the subscription and the stream comes back when the client reactivates.
+void testStaleEventsAndStop() {
+  CommandStream s;
+  FakeTransport t;
+  setup(s, t);
+  run(s, t, 500);
+  bool v = false;
+  s.takeValue(v);
+  s.onDrop();
+  s.onValue(true, t.nowMs);  // late event from the dropped subscription
+  CHECK(!s.alive());
+  CHECK(!s.takeValue(v));
+
+  s.stop();
+  CHECK(t.open == 0);
+  s.onKeepAlive(t.nowMs);
+  CHECK(!s.alive());
+  run(s, t, 2000, false);
+  CHECK(t.open == 0);
+  run(s, t, 2000);
+  CHECK(t.open == 1);
+  CHECK(s.alive());
+  CHECK(t.unsubscribes == 1);
+}
+
+}  // namespace
+
+int main() {
+  testFirstSubscribe();
+  testSilenceResync();
+  testBackoff();
+  testStaleEventsAndStop();
+  printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+// FS.h (host test stand-in)
+// In-memory filesystem with fault injection: writes can be cut off after a
+// byte budget (power loss mid-write) and renames can be made to fail.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+struct FakeDisk {
+  std::map<std::string, std::vector<uint8_t>> files;
+  long writeBudget = -1;  // bytes that may still be written (any file); -1 = unlimited
+  std::string failPath;   // writes to this file only fail once failBudget is spent
+  long failBudget = -1;
+  bool failRename = false;
+
+  void clearFaults() {
+    writeBudget = -1;
+    failPath.clear();
+    failBudget = -1;
+    failRename = false;
+  }
+};
+extern FakeDisk gDisk;
+
+class File {
+ public:
+  File() = default;
+  File(const std::string &path, size_t pos) : path_(path), pos_(pos), open_(true) {}
+
+  explicit operator bool() const { return open_ && gDisk.files.count(path_); }
+
+  size_t write(const uint8_t* data, size_t len) {
+    if (!*this) return 0;
+    std::vector<uint8_t> &bytes = gDisk.files[path_];
+    size_t n = 0;
+    for (; n < len; n++) {
+      if (gDisk.writeBudget == 0) break;
+      if (path_ == gDisk.failPath && gDisk.failBudget == 0) break;
+      if (gDisk.writeBudget > 0) gDisk.writeBudget--;
+      if (path_ == gDisk.failPath && gDisk.failBudget > 0) gDisk.failBudget--;
+      if (pos_ < bytes.size()) bytes[pos_] = data[n];
+      else bytes.push_back(data[n]);
+      pos_++;
+    }
+    return n;
+  }
+
+  size_t read(uint8_t* out, size_t len) {
+    if (!*this) return 0;
+    const std::vector<uint8_t> &bytes = gDisk.files[path_];
+    size_t n = 0;
+    for (; n < len && pos_ < bytes.size(); n++) out[n] = bytes[pos_++];
+    return n;
+  }
+
+  bool seek(uint32_t pos) {
+    if (!*this || pos > gDisk.files[path_].size()) return false;
+    pos_ = pos;
+    return true;
+  }
+
+  size_t size() const { return *this ? gDisk.files[path_].size() : 0; }
+  size_t position() const { return pos_; }
+  void close() { open_ = false; }
+
+ private:
+  std::string path_;
+  size_t pos_ = 0;
+  bool open_ = false;
+};
+
+class FS {
+ public:
+  File open(const char* path, const char* mode = FILE_READ) {
+    const std::string p(path);
+    if (mode[0] == 'r') return gDisk.files.count(p) ? File(p, 0) : File();
+    if (mode[0] == 'w') gDisk.files[p].clear();
+    return File(p, gDisk.files[p].size());
+  }
+  bool exists(const char* path) { return gDisk.files.count(path) != 0; }
+  bool remove(const char* path) { return gDisk.files.erase(path) != 0; }
+  bool rename(const char* from, const char* to) {
+    if (gDisk.failRename || !gDisk.files.count(from)) return false;
+    gDisk.files[to] = gDisk.files[from];
+    gDisk.files.erase(from);
+    return true;
+  }
+};
+
+}  // namespace fs
+
+using fs::File;
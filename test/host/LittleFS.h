@@ -0,0 +1,11 @@
+// LittleFS.h (host test stand-in)
+
+#pragma once
+
+#include <FS.h>
+
+class LittleFSFS : public fs::FS {
+ public:
+  bool begin(bool /*formatOnFail*/ = false) { return true; }
+};
+extern LittleFSFS LittleFS;
@@ -0,0 +1,225 @@
+// UsageJournalTest.cpp
+// Host-side crash-consistency test for UsageJournal against an in-memory
+// LittleFS with injected torn writes and failed renames. Build and run from
+// the repo root (a small size cap makes compaction frequent):
+//   g++ -std=gnu++17 -I. -Itest/host -DBUILD_JOURNAL_MAX_BYTES=1024
+//       test/host/UsageJournalTest.cpp src/infrastructure/UsageJournal.cpp
+//       src/infrastructure/Logger.cpp -o /tmp/journal_test && /tmp/journal_test
+
+#include <set>
+#include <vector>
+
+#include <LittleFS.h>
+
+#include "src/infrastructure/UsageJournal.h"
+
+HostSerial Serial;
+fs::FakeDisk fs::gDisk;
+LittleFSFS LittleFS;
+
+namespace {
+
+const char* kPath = "/usage.jnl";
+const char* kTmpPath = "/usage.tmp";
+
+int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);            \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+UsageJournal::Entry entry(UsageJournal::Kind kind, uint32_t cycleId) {
+  UsageJournal::Entry e;
+  e.kind = kind;
+  e.cycleId = cycleId;
+  e.durationSec = kind == UsageJournal::kEnd ? 60 : 0;
+  strncpy(e.reason, "command", sizeof(e.reason) - 1);
+  return e;
+}
+
+// Pending entries as (seq, cycleId) pairs, read back through the index.
+std::vector<std::pair<uint32_t, uint32_t>> pending(UsageJournal &j) {
+  std::vector<std::pair<uint32_t, uint32_t>> out;
+  struct Visit {
+    static void add(const UsageJournal::Entry &e, void* ctx) {
+      static_cast<std::vector<std::pair<uint32_t, uint32_t>>*>(ctx)->push_back({e.seq, e.cycleId});
+    }
+  };
+  j.forEachPending(&Visit::add, &out);
+  return out;
+}
+
+std::set<uint32_t> seqs(UsageJournal &j) {
+  std::set<uint32_t> out;
+  for (const auto &p : pending(j)) out.insert(p.first);
+  return out;
+}
+
+void reset() {
+  fs::gDisk.files.clear();
+  fs::gDisk.clearFaults();
+}
+
+void testAppendAckRecover() {
+  reset();
+  {
+    UsageJournal j;
+    CHECK(j.begin());
+    UsageJournal::Entry a = entry(UsageJournal::kStart, 100);
+    UsageJournal::Entry b = entry(UsageJournal::kEnd, 100);
+    UsageJournal::Entry c = entry(UsageJournal::kStart, 200);
+    CHECK(j.append(a) && j.append(b) && j.append(c));
+    CHECK(j.ack(a.seq));
+  }
+  UsageJournal j;
+  CHECK(j.begin());
+  const auto p = pending(j);
+  CHECK(p.size() == 2);
+  CHECK(p.size() == 2 && p[0].second == 100 && p[1].second == 200);
+  UsageJournal::Entry open;
+  CHECK(j.openCycle(open) && open.cycleId == 200);
+}
+
+// Power loss after every possible byte count of a fixed workload: after the
+// reboot exactly the operations that reported success are visible, and new
+// appends land where the next recovery finds them.
+void testPowerLossSweep() {
+  for (long cut = 0;; cut++) {
+    reset();
+    std::set<uint32_t> expected;
+    bool cutHit = false;
+    {
+      UsageJournal j;
+      j.begin();
+      fs::gDisk.writeBudget = cut;
+      for (uint32_t i = 0; i < 24; i++) {
+        UsageJournal::Entry e = entry(i % 2 ? UsageJournal::kEnd : UsageJournal::kStart, 1000 + i / 2);
+        if (j.append(e)) expected.insert(e.seq);
+        if (i % 3 == 2 && !expected.empty()) {
+          const uint32_t seq = *expected.begin();
+          if (j.ack(seq)) expected.erase(seq);
+        }
+      }
+      cutHit = fs::gDisk.writeBudget == 0;
+    }
+    fs::gDisk.clearFaults();
+    UsageJournal j;
+    CHECK(j.begin());
+    const std::set<uint32_t> got = seqs(j);
+    // An ack that failed to persist leaves its entry pending (replayed again);
+    // a successful op must never be lost.
+    for (uint32_t s : expected) CHECK(got.count(s));
+    UsageJournal::Entry extra = entry(UsageJournal::kStart, 9999);
+    CHECK(j.append(extra));
+    UsageJournal again;
+    CHECK(again.begin());
+    CHECK(seqs(again).count(extra.seq));
+    if (!cutHit) break;  // the workload finished within the budget: every cut point covered
+  }
+}
+
+// A compaction whose temp-file write fails must leave the live index intact.
+void testCompactionWriteFailure() {
+  reset();
+  UsageJournal j;
+  CHECK(j.begin());
+  std::vector<std::pair<uint32_t, uint32_t>> model;
+  for (uint32_t i = 0; i < 4; i++) {
+    UsageJournal::Entry e = entry(UsageJournal::kStart, 500 + i);
+    CHECK(j.append(e));
+    model.push_back({e.seq, e.cycleId});
+  }
+  // Fill the file with acked traffic until the next append has to compact,
+  // with the temp file failing a few bytes in.
+  uint32_t cycle = 600;
+  while (j.stats().bytes + 2 * 80 < BUILD_JOURNAL_MAX_BYTES) {
+    UsageJournal::Entry e = entry(UsageJournal::kStart, cycle++);
+    CHECK(j.append(e));
+    CHECK(j.ack(e.seq));
+  }
+  fs::gDisk.failPath = kTmpPath;
+  fs::gDisk.failBudget = 20;
+  const uint32_t compactionsBefore = j.stats().compactions;
+  for (int i = 0; i < 4; i++) {
+    UsageJournal::Entry e = entry(UsageJournal::kStart, cycle++);
+    if (j.append(e)) model.push_back({e.seq, e.cycleId});
+  }
+  CHECK(j.stats().compactions == compactionsBefore);
+  CHECK(!fs::gDisk.files.count(kTmpPath));
+  CHECK(pending(j) == model);
+  // Acks still hit the right records, in this session and after a reboot.
+  CHECK(j.ack(model[1].first));
+  model.erase(model.begin() + 1);
+  CHECK(pending(j) == model);
+  fs::gDisk.clearFaults();
+  UsageJournal r;
+  CHECK(r.begin());
+  CHECK(pending(r) == model);
+}
+
+// Rename failure after the old journal was removed: journaling stops for the
+// session and the next boot adopts the complete temp file.
+void testCompactionRenameFailure() {
+  reset();
+  std::vector<std::pair<uint32_t, uint32_t>> model;
+  {
+    UsageJournal j;
+    CHECK(j.begin());
+    uint32_t cycle = 700;
+    for (uint32_t i = 0; i < 3; i++) {
+      UsageJournal::Entry e = entry(UsageJournal::kStart, cycle++);
+      CHECK(j.append(e));
+      model.push_back({e.seq, e.cycleId});
+    }
+    while (j.stats().bytes + 80 <= BUILD_JOURNAL_MAX_BYTES) {
+      UsageJournal::Entry e = entry(UsageJournal::kStart, cycle++);
+      CHECK(j.append(e));
+      CHECK(j.ack(e.seq));
+    }
+    fs::gDisk.failRename = true;
+    UsageJournal::Entry e = entry(UsageJournal::kStart, cycle++);
+    CHECK(!j.append(e));
+    CHECK(!j.ready());
+    CHECK(!fs::gDisk.files.count(kPath) && fs::gDisk.files.count(kTmpPath));
+  }
+  fs::gDisk.clearFaults();
+  UsageJournal j;
+  CHECK(j.begin());
+  CHECK(pending(j) == model);
+}
+
+// Reset during compaction, before the rename: the journal stays authoritative.
+void testInterruptedCompaction() {
+  reset();
+  std::vector<std::pair<uint32_t, uint32_t>> model;
+  {
+    UsageJournal j;
+    CHECK(j.begin());
+    for (uint32_t i = 0; i < 3; i++) {
+      UsageJournal::Entry e = entry(UsageJournal::kStart, 800 + i);
+      CHECK(j.append(e));
+      model.push_back({e.seq, e.cycleId});
+    }
+  }
+  fs::gDisk.files[kTmpPath] = std::vector<uint8_t>(37, 0xA5);  // half-written copy
+  UsageJournal j;
+  CHECK(j.begin());
+  CHECK(!fs::gDisk.files.count(kTmpPath));
+  CHECK(pending(j) == model);
+}
+
+}  // namespace
+
+int main() {
+  testAppendAckRecover();
+  testPowerLossSweep();
+  testCompactionWriteFailure();
+  testCompactionRenameFailure();
+  testInterruptedCompaction();
+  printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+// WiFi.h (host test stand-in)
+// Only the resolver: a scripted table of host -> address. Lookups are
+// counted and can be made to fail.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <Arduino.h>
+
+struct WiFiClass {
+  std::map<std::string, IPAddress> dns;
+  int lookups = 0;
+  uint32_t lookupMs = 0;  // added to the host clock per lookup
+
+  int hostByName(const char* host, IPAddress &out) {
+    lookups++;
+    hostMillis += lookupMs;
+    auto it = dns.find(host);
+    if (it == dns.end()) return 0;
+    out = it->second;
+    return 1;
+  }
+};
+extern WiFiClass WiFi;
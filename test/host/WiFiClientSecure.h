@@ -0,0 +1,49 @@
+// WiFiClientSecure.h (host test stand-in)
+// Fake TLS transport: connects by address succeed only for addresses in the
+// reachable set and take handshakeMs of host time. Keeps the connection open
+// until stop(), like the keep-alive connections of the real client.
+
+#pragma once
+
+#include <vector>
+
+#include <Arduino.h>
+
+struct FakeTls {
+  std::vector<IPAddress> reachable;
+  uint32_t handshakeMs = 0;
+  int connects = 0;          // attempts, successful or not
+  IPAddress lastIp;
+  const char* lastSni = nullptr;
+};
+extern FakeTls gTls;
+
+class WiFiClientSecure {
+ public:
+  virtual ~WiFiClientSecure() {}
+  virtual int connect(const char* /*host*/, uint16_t /*port*/) { return 0; }
+  int connect(IPAddress ip, uint16_t /*port*/, const char* host, const char* /*ca*/, const char* /*cert*/,
+              const char* /*key*/) {
+    gTls.connects++;
+    gTls.lastIp = ip;
+    gTls.lastSni = host;
+    hostMillis += gTls.handshakeMs;
+    for (const IPAddress &r : gTls.reachable) {
+      if (r == ip) {
+        open_ = true;
+        return 1;
+      }
+    }
+    return 0;
+  }
+  uint8_t connected() { return open_ ? 1 : 0; }
+  void stop() { open_ = false; }
+
+ protected:
+  const char* _CA_cert = nullptr;
+  const char* _cert = nullptr;
+  const char* _private_key = nullptr;
+
+ private:
+  bool open_ = false;
+};